@@ -1,432 +1,7841 @@
-/***************************************************************
- * ProjectTwo.cpp
- * CS 300 - ABCU Advising Assistance Program
- *
- * This program reads a CSV file containing course information, stores the data in a binary search tree (BST), and provides a menu-driven interface for:
- *   1) Loading the data,
- *   2) Printing an alphanumeric course list,
- *   3) Printing details for a specific course (title + prerequisites),
- *   9) Exiting the program.
- *
- * Author: Christopher Davidson
- * Date: 2/22/25
- ***************************************************************/
-
-#include <iostream>
-#include <string>
-#include <vector>
-#include <sstream>
-#include <fstream>
-#include <algorithm>
-#include <cctype>
-// For numeric_limits
-#include <limits>
-
-using namespace std;
-
-/***************************************************************
- * Course Struct
- *
- * Represents a single course, storing:
- * - courseNumber
- * - courseName
- * - prerequisites (list of courseNumbers)
- ***************************************************************/
-struct Course {
-    string courseNumber;
-    string courseName;
-    vector<string> prerequisites;
-
-    // Helper method to print just the course number and course name
-    void printCourseBasic() const {
-        cout << courseNumber << ", " << courseName << endl;
-    }
-};
-
-/***************************************************************
- * Node Struct
- *
- * A node in the binary search tree (BST). It contains one Course, plus pointers to its left and right child nodes.
- ***************************************************************/
-struct Node {
-    // The actual course data
-    Course course;
-    // Pointer to left child in the BST
-    Node* left;
-    // Pointer to right child in the BST
-    Node* right;
-
-    // Constructor for convenience
-    Node(const Course& c) : course(c), left(nullptr), right(nullptr) {}
-};
-
-/***************************************************************
- * CourseBST Class
- *
- * A binary search tree keyed by courseNumber in alphanumeric order. Provides:
- *   - insert (Course)
- *   - printAll() (in-order traversal)
- *   - search (courseNumber)
- *   - destructor for cleanup
- ***************************************************************/
-class CourseBST {
-private:
-    // The root node of the BST
-    Node* root;
-
-    // Recursively inserts a course into the BST by courseNumber
-    void addNode(Node*& node, const Course& course) {
-        // If position is empty, place the new course here
-        if (!node) {
-            node = new Node(course);
-        }
-        // Or compare courseNumber to decide left or right subtree
-        else if (course.courseNumber < node->course.courseNumber) {
-            addNode(node->left, course);
-        }
-        else {
-            addNode(node->right, course);
-        }
-    }
-
-    // Recursively performs an in order traversal and prints each course as the user visits it
-    void inOrder(Node* node) const {
-        // Base case: null node
-        if (!node) return;
-        // Traverse left subtree
-        inOrder(node->left);
-        // Print current node
-        node->course.printCourseBasic();
-        // Traverse right subtree
-        inOrder(node->right);
-    }
-
-    // Recursively searches for a course by its courseNumber
-    Course* searchNode(Node* node, const string& courseNumber) const {
-        // If node is null, the course doesn't exist in this subtree
-        if (!node) return nullptr;
-
-        // Compare target courseNumber with current node's courseNumber
-        if (node->course.courseNumber == courseNumber) {
-            return &(node->course);
-        }
-        else if (courseNumber < node->course.courseNumber) {
-            return searchNode(node->left, courseNumber);
-        }
-        else {
-            return searchNode(node->right, courseNumber);
-        }
-    }
-
-    // Recursively destroys all nodes to free memory
-    void destroy(Node* node) {
-        // Base case
-        if (!node) return;
-        destroy(node->left);
-        destroy(node->right);
-        delete node;
-    }
-
-public:
-    // Constructor initializes an empty BST
-    CourseBST() : root(nullptr) {}
-
-    // Destructor calls recursive destroy to free all nodes
-    ~CourseBST() {
-        destroy(root);
-    }
-
-    // Inserts a new course into the BST
-    void insert(const Course& course) {
-        addNode(root, course);
-    }
-
-    // Prints all courses in sorted order by courseNumber
-    void printAll() const {
-        inOrder(root);
-    }
-
-    // Returns a pointer to the course if found, otherwise nullptr
-    Course* search(const string& courseNumber) const {
-        return searchNode(root, courseNumber);
-    }
-};
-
-/***************************************************************
- * Utility: toUpperTrim
- *
- * Trims leading/trailing whitespace, then converts string to uppercase. Ensures consistent matching of course numbers like "csci100" -> "CSCI100".
- ***************************************************************/
-string toUpperTrim(const string& str) {
-    // Find first and last non-whitespace characters
-    size_t start = str.find_first_not_of(" \t\r\n");
-    size_t end = str.find_last_not_of(" \t\r\n");
-
-    // Extract substring if the user found real content
-    string trimmed;
-    if (start != string::npos && end != string::npos) {
-        trimmed = str.substr(start, end - start + 1);
-    }
-
-    // Convert to uppercase
-    for (auto& c : trimmed) {
-        c = toupper(static_cast<unsigned char>(c));
-    }
-    return trimmed;
-}
-
-/***************************************************************
- * loadCourses
- *
- * Reads a CSV file (named filename) line by line, splitting each line on commas to get:
- *    [courseNumber, courseName, prereq1, prereq2]
- *
- * Then it creates a Course object and inserts it into the BST.
- * If the file can't be opened, an error is displayed.
- ***************************************************************/
-void loadCourses(const string& filename, CourseBST& bst) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        // If file isn't found or can't be opened, print an error
-        cout << "ERROR: Could not open file: " << filename << endl;
-        return;
-    }
-
-    cout << "Loading courses from " << filename << "..." << endl;
-
-    string line;
-    while (getline(file, line)) {
-        // Skip any blank lines (just in case)
-        if (line.empty()) continue;
-
-        // Split the line by commas to get tokens
-        vector<string> tokens;
-        string token;
-        stringstream ss(line);
-
-        while (getline(ss, token, ',')) {
-            tokens.push_back(token);
-        }
-
-        // Expect at least 2 tokens: courseNumber and courseName
-        if (tokens.size() < 2) {
-            cout << "WARNING: Invalid course line (skipped): " << line << endl;
-            continue;
-        }
-
-        // Create a Course object from these tokens
-        Course course;
-        course.courseNumber = toUpperTrim(tokens[0]);
-        course.courseName = tokens[1];
-
-        // Any remaining tokens are prerequisites
-        for (size_t i = 2; i < tokens.size(); ++i) {
-            course.prerequisites.push_back(toUpperTrim(tokens[i]));
-        }
-
-        // Insert the course into the BST
-        bst.insert(course);
-    }
-
-    file.close();
-    cout << "Courses loaded into data structure." << endl;
-}
-
-/***************************************************************
- * printCourseInfo
- *
- * Prompts the user for a courseNumber, searches for that course in the BST, then prints its name and prerequisites (if any).
- * If a prerequisite is also in the BST, prints its name too.
- ***************************************************************/
-void printCourseInfo(const CourseBST& bst) {
-    cout << "What course do you want to know about? ";
-    string userInput;
-    getline(cin, userInput);
-    string courseKey = toUpperTrim(userInput);
-
-    // Search for the course in the BST
-    Course* course = bst.search(courseKey);
-    if (!course) {
-        // If the course can't be found, inform the user
-        cout << "Course not found." << endl;
-        return;
-    }
-
-    // Print the main course info: number + title
-    cout << course->courseNumber << ", " << course->courseName << endl;
-
-    // If this course has prerequisites, display them
-    if (!course->prerequisites.empty()) {
-        cout << "Prerequisites: ";
-        bool firstPrinted = false;
-
-        // For each prerequisite ID, check if it's in the BST to get the full name
-        for (const auto& prereqID : course->prerequisites) {
-            if (firstPrinted) {
-                cout << ", ";
-            }
-            else {
-                firstPrinted = true;
-            }
-
-            Course* prereqCourse = bst.search(prereqID);
-            if (prereqCourse) {
-                // Print "CSCI101: Introduction to Programming in C++"
-                cout << prereqCourse->courseNumber << ": " << prereqCourse->courseName;
-            }
-            else {
-                // If not found, show only the ID
-                cout << prereqID << ": None Required";
-            }
-        }
-        cout << endl;
-    }
-    else {
-        // This course has no prerequisites
-        cout << "Prerequisites: None" << endl;
-    }
-}
-
-/***************************************************************
- * main
- *
- * Main entry point. Presents a menu-driven UI that allows users to:
- *   - Load courses from a file (Option 1)
- *   - Print all courses in sorted order (Option 2)
- *   - Search for a single course (Option 3)
- *   - Exit (Option 9)
- *
- * If the user attempts to print or search before loading, they are prompted to load data first.
- ***************************************************************/
-int main() {
-    // Chosen data structure (BST)
-    CourseBST bst;
-    // Tracks whether data has been loaded
-    bool loaded = false; 
-
-    cout << "Welcome to the course planner." << endl << endl;
-
-    int choice = 0;
-    while (choice != 9) {
-        // Display menu options
-        cout << "  1. Load Data Structure." << endl;
-        cout << "  2. Print Course List." << endl;
-        cout << "  3. Print Course." << endl;
-        cout << "  9. Exit" << endl;
-        cout << endl << "What would you like to do? ";
-
-        cin >> choice;
-
-        // Check if cin failed to parse an integer
-        if (!cin) {
-            // Clear error flags
-            cin.clear();
-            // Discard any leftover input up to a newline (prevents infinite loop)
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-
-            // Show a single error message
-            cout << "Input is not a valid option." << endl << endl;
-
-            // Go back to top of the while loop (re-display the menu)
-            continue;
-        }
-
-        // Clear leftover newline from input buffer
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-
-        // Respond to user's choice
-        switch (choice) {
-        // Added tools to improve user experience
-        case 1: {
-            cout << "Enter the file name to load (case-insensitive, with or without .csv): ";
-            string inputName;
-            getline(cin, inputName);
-
-            // The *correct base name* in exact case
-            const string correctBase = "CS 300 ABCU_Advising_Program_Input";
-            // Use all-caps of the base for easy ignoring-case checks
-            const string correctBaseCaps = "CS 300 ABCU_ADVISING_PROGRAM_INPUT";
-
-            // Convert user input to uppercase for comparison
-            string inputCaps = inputName;
-            for (auto& c : inputCaps) {
-                c = toupper(static_cast<unsigned char>(c));
-            }
-
-            // STEP 1: Check if the user typed .csv at the end (in any case).
-            //         If yes, remove it before comparing to the correct base.
-            bool hasCsvExtension = false;
-            if (inputCaps.size() >= 4 &&
-                inputCaps.substr(inputCaps.size() - 4) == ".CSV")
-            {
-                hasCsvExtension = true;
-                // Remove the last 4 characters (".csv") so the base is left
-                inputCaps = inputCaps.substr(0, inputCaps.size() - 4);
-            }
-
-            // STEP 2: Compare what's left to the expected base name, ignoring case
-            if (inputCaps == correctBaseCaps) {
-                // If it matches ignoring case, accept it.
-                // Build the final filename in the exact case desired:
-                string finalFilename = correctBase + ".csv";
-
-                // Inform the user to how their input is being resolved
-                cout << "Using file: " << finalFilename << endl;
-
-                // Now actually load courses from that file
-                loadCourses(finalFilename, bst);
-                loaded = true;
-            }
-            else {
-                // The input didn't match "CS 300 ABCU_Advising_Program_Input" ignoring case
-                cout << "ERROR: The file name does not match \""
-                    << correctBase << "\" (ignoring case)." << endl;
-                cout << "Please re-check your spelling and try again." << endl;
-            }
-
-            break;
-        }
-        case 2:
-            if (!loaded) {
-                // If no data loaded yet, ask user to load first
-                cout << "Please load courses before printing the list." << endl;
-            }
-            else {
-                // Print all courses in sorted (in-order) order
-                cout << "Here is the course schedule:" << endl << endl;
-                bst.printAll();
-                cout << endl;
-            }
-            break;
-        case 3:
-            if (!loaded) {
-                // If no is data loaded, it is impossible to search
-                cout << "Please load courses before searching for a course." << endl;
-            }
-            else {
-                printCourseInfo(bst);
-                cout << endl;
-            }
-            break;
-        case 9:
-            // Exit the loop => end program
-            cout << "Thank you for using the course planner!" << endl;
-            cout << "Press ENTER to close the program..." << endl;
-
-            // Clear any leftover characters from the buffer
-            cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            // Wait for the user to press ENTER
-            cin.get();
-
-            // After the user presses ENTER the program ends.
-            break;
-        default:
-            // Invalid menu option
-            cout << choice << " is not a valid option." << endl << endl;
-            break;
-        }
-    }
-
-    // End of program
-    return 0;  
-}
+/***************************************************************
+ * ProjectTwo.cpp
+ * CS 300 - ABCU Advising Assistance Program
+ *
+ * This program reads a CSV file containing course information, stores the data in a self-balancing (AVL) binary search tree (BST), and provides a menu-driven interface for:
+ *   1) Loading the data,
+ *   2) Printing an alphanumeric course list,
+ *   3) Printing details for a specific course (title + prerequisites),
+ *   4) Comparing insert-based loading against bulk building on the loaded file,
+ *   5) Printing the full (transitive) prerequisite chain of a course,
+ *   6) Planning the semesters needed to reach a set of target courses,
+ *   7) Listing the courses whose numbers start with a prefix,
+ *   8) Listing the courses in a range of course numbers,
+ *   9) Exiting the program,
+ *  10) Searching course titles (with suggestions for near misses),
+ *  11) Showing statistics about the tree, the caches and the last load,
+ *  12) Validating the loaded catalog.
+ *
+ * Author: Christopher Davidson
+ * Date: 2/22/25
+ ***************************************************************/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+// For move/forward and in_place
+#include <utility>
+// For numeric_limits
+#include <limits>
+// For timing the load modes
+#include <chrono>
+// For sorting large catalogs on several cores
+#include <thread>
+// For placement new in the node arena, and the counting operator new
+#include <new>
+// For the allocation counter
+#include <atomic>
+// For the intern pool's per-shard locks
+#include <mutex>
+#include <cstdlib>
+// For memchr when splitting the file at newlines
+#include <cstring>
+// For the CSV's size and modification time when validating a snapshot
+#include <filesystem>
+// For zero-copy views over the mapped CSV bytes
+#include <string_view>
+// For fixed-width masks in the SIMD scanner
+#include <cstdint>
+// For the new courseNumbers seen during a reload
+#include <unordered_set>
+// For the response cache's key lookup
+#include <unordered_map>
+// For the snapshot main keeps while a reload decides whether to replace it
+#include <memory>
+// For formatting numbers straight into the output buffer
+#include <charconv>
+#include <cstdio>
+#include <type_traits>
+// For the tree iterator's category tag
+#include <iterator>
+// For server mode's connection queue and reload requests
+#include <condition_variable>
+#include <deque>
+#include <csignal>
+#include <cerrno>
+// For the CSV column schema
+#include <array>
+#include <tuple>
+// For the title index's deferred build
+#include <functional>
+
+// Vector instruction set used by the byte scanners (define ABCU_SCALAR_ONLY to force the portable loops)
+#if !defined(ABCU_SCALAR_ONLY)
+#if defined(__AVX2__)
+#define ABCU_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ABCU_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define ABCU_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// For memory-mapping the CSV file
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// For server mode
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#endif
+
+using namespace std;
+
+/***************************************************************
+ * Metrics
+ *
+ * Counters and timers on the hot paths, shown by the menu's Show Statistics option (see printMetrics):
+ * how long each phase of the last load took and what it skipped, how many slots each course search probed,
+ * how many nodes each ordered seek compared, and how long each menu command took.
+ * Every hook is one ABCU_METRIC(...) statement; define ABCU_NO_METRICS to compile them all out
+ * (the types stay, but nothing records into them).
+ * The per-search histograms are kept per thread (see ThreadCounts), so server workers never write to a shared
+ * cache line on a lookup; Show Statistics adds them up when it reads them.
+ ***************************************************************/
+#if !defined(ABCU_NO_METRICS)
+#define ABCU_METRICS
+#define ABCU_METRIC(...) __VA_ARGS__
+#else
+#define ABCU_METRIC(...)
+#endif
+
+/***************************************************************
+ * Heap allocation counter
+ *
+ * With metrics compiled in, replaces the global operator new/delete with thin wrappers around malloc/free that count
+ * every allocation, so the loader can report how many heap allocations each record costs. Each thread counts into its
+ * own AllocationTally and adds it to exitedThreadAllocations when it exits, so no allocation writes to shared memory.
+ * heapAllocations() is the calling thread's count plus those of the threads that have exited: read before and after
+ * a load, the difference covers the loading thread and the parser threads it joined (and any unrelated thread that
+ * happened to exit meanwhile). Built with ABCU_NO_METRICS, allocation is left alone and the loader doesn't report it.
+ ***************************************************************/
+#if defined(ABCU_METRICS)
+static atomic<size_t> exitedThreadAllocations(0);
+
+struct AllocationTally {
+    size_t count = 0;
+
+    ~AllocationTally() {
+        exitedThreadAllocations.fetch_add(count, memory_order_relaxed);
+    }
+};
+
+static thread_local AllocationTally allocationTally;
+
+inline size_t heapAllocations() {
+    return exitedThreadAllocations.load(memory_order_relaxed) + allocationTally.count;
+}
+
+// Kept out of line so GCC doesn't see malloc/free paired with new/delete at the inlined call sites
+#if defined(__GNUC__)
+#define ABCU_NOINLINE __attribute__((noinline))
+#else
+#define ABCU_NOINLINE
+#endif
+
+ABCU_NOINLINE void* operator new(size_t size) {
+    ++allocationTally.count;
+    if (void* memory = malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw bad_alloc();
+}
+
+ABCU_NOINLINE void* operator new(size_t size, const nothrow_t&) noexcept {
+    ++allocationTally.count;
+    return malloc(size ? size : 1);
+}
+
+ABCU_NOINLINE void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+ABCU_NOINLINE void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+ABCU_NOINLINE void operator delete(void* memory, const nothrow_t&) noexcept {
+    free(memory);
+}
+#endif
+
+// Nanoseconds on the steady clock
+inline uint64_t metricsClock() {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/***************************************************************
+ * CountHistogram Struct
+ *
+ * How many times each small count (comparisons, probes) was recorded; counts of 63 or more share the last bucket.
+ * Only one thread records into a histogram, so record() is a plain load and store rather than a locked add;
+ * the buckets are atomic only so another thread can read them while it runs.
+ ***************************************************************/
+struct CountHistogram {
+    static constexpr size_t bucketCount = 64;
+    atomic<uint64_t> buckets[bucketCount] = {};
+
+    void record(size_t value) {
+        atomic<uint64_t>& bucket = buckets[min(value, bucketCount - 1)];
+        bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    // Adds another histogram's counts into this one (the caller keeps other's owner from recording meanwhile,
+    // or accepts a count that is a few samples behind)
+    void add(const CountHistogram& other) {
+        for (size_t i = 0; i < bucketCount; ++i) {
+            buckets[i].fetch_add(other.buckets[i].load(memory_order_relaxed), memory_order_relaxed);
+        }
+    }
+
+    uint64_t samples() const {
+        uint64_t total = 0;
+        for (const auto& bucket : buckets) total += bucket.load(memory_order_relaxed);
+        return total;
+    }
+};
+
+/***************************************************************
+ * ThreadCounts Struct
+ *
+ * The histograms each thread records its own searches into (see Metrics::local).
+ ***************************************************************/
+struct ThreadCounts {
+    // Hash slots examined per CourseBST::search (the final empty slot of a miss included)
+    CountHistogram searchProbes;
+    // Tree nodes compared per ordered seek (lowerBound / upperBound)
+    CountHistogram seekComparisons;
+
+    void add(const ThreadCounts& other) {
+        searchProbes.add(other.searchProbes);
+        seekComparisons.add(other.seekComparisons);
+    }
+};
+
+/***************************************************************
+ * LatencyHistogram Struct
+ *
+ * Durations in power-of-two buckets of nanoseconds (bucket b holds [2^b, 2^(b+1))), plus their total and maximum.
+ ***************************************************************/
+struct LatencyHistogram {
+    static constexpr size_t bucketCount = 48;
+    atomic<uint64_t> buckets[bucketCount] = {};
+    atomic<uint64_t> totalNanos{ 0 };
+    atomic<uint64_t> maxNanos{ 0 };
+
+    void record(uint64_t nanos) {
+        size_t bucket = 0;
+        while (bucket + 1 < bucketCount && (nanos >> (bucket + 1)) != 0) ++bucket;
+        buckets[bucket].fetch_add(1, memory_order_relaxed);
+        totalNanos.fetch_add(nanos, memory_order_relaxed);
+        uint64_t seen = maxNanos.load(memory_order_relaxed);
+        while (nanos > seen && !maxNanos.compare_exchange_weak(seen, nanos, memory_order_relaxed)) {}
+    }
+
+    uint64_t samples() const {
+        uint64_t total = 0;
+        for (const auto& bucket : buckets) total += bucket.load(memory_order_relaxed);
+        return total;
+    }
+
+    // Upper end of the bucket that holds the given fraction of the samples (0 if there are none)
+    uint64_t percentile(double fraction) const {
+        uint64_t wanted = static_cast<uint64_t>(fraction * samples());
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            seen += buckets[bucket].load(memory_order_relaxed);
+            if (seen > wanted) return uint64_t(2) << bucket;
+        }
+        return 0;
+    }
+};
+
+/***************************************************************
+ * LoadProfile Struct
+ *
+ * Where one loadCourses call spent its time, and what it read and skipped:
+ *   - read:      opening and mapping the file, or reading a streamed feed's blocks
+ *   - split:     cutting the bytes into lines and finding each line's required fields (a mapped file's pages are faulted in here)
+ *   - normalize: upper-casing, trimming, interning and hashing each line's fields into a Course
+ *                (prerequisite fields are found as they are stored, so their scanning counts here)
+ *   - insert:    building the tree (bulk build, or one insert per course)
+ *   - resolve:   linking prerequisites to their courses
+ * Each phase is summed over the threads that ran it, and phases on different threads overlap (parallel parsing, or the
+ * streaming reader and inserter), so together they can exceed the total.
+ ***************************************************************/
+struct LoadProfile {
+    uint64_t readNanos = 0;
+    uint64_t splitNanos = 0;
+    uint64_t normalizeNanos = 0;
+    uint64_t insertNanos = 0;
+    uint64_t resolveNanos = 0;
+    uint64_t totalNanos = 0;
+    // Non-blank lines seen, and what became of them
+    uint64_t lines = 0;
+    uint64_t courses = 0;
+    uint64_t invalidLines = 0;
+    uint64_t duplicates = 0;
+    uint64_t danglingPrerequisites = 0;
+
+    // Adds the parse-side figures of one chunk of the file
+    void addParse(const LoadProfile& chunk) {
+        readNanos += chunk.readNanos;
+        splitNanos += chunk.splitNanos;
+        normalizeNanos += chunk.normalizeNanos;
+        lines += chunk.lines;
+    }
+};
+
+/***************************************************************
+ * Metrics Struct
+ *
+ * Everything the hooks record, in one global (metrics). The search histograms live in one ThreadCounts per thread:
+ * local() hands a thread its own, and counts() adds up every live thread's and those of threads that have exited.
+ ***************************************************************/
+struct Metrics {
+    // Menu options are numbered up to 12; anything else is recorded under 0
+    static constexpr size_t commandCount = 13;
+
+    // The most recent successful loadCourses (a server reload may publish it from another thread)
+    mutex lastLoadLock;
+    LoadProfile lastLoad;
+    // Every running thread's ThreadCounts, and the sum of those whose threads have exited
+    mutex threadCountsLock;
+    vector<ThreadCounts*> liveCounts;
+    ThreadCounts retiredCounts;
+    // Time each menu command spent working, not counting the time spent waiting for the user to type
+    LatencyHistogram commands[commandCount];
+    // Total time spent in readUserLine, which the menu subtracts from its commands
+    atomic<uint64_t> inputWaitNanos{ 0 };
+
+    void publishLoad(const LoadProfile& profile) {
+        lock_guard<mutex> guard(lastLoadLock);
+        lastLoad = profile;
+    }
+
+    LoadProfile loadSnapshot() {
+        lock_guard<mutex> guard(lastLoadLock);
+        return lastLoad;
+    }
+
+    // This thread's histograms, registered on first use and folded into retiredCounts when the thread exits
+    ThreadCounts& local();
+
+    // Adds up the search histograms of every thread so far into total
+    void counts(ThreadCounts& total) {
+        lock_guard<mutex> guard(threadCountsLock);
+        total.add(retiredCounts);
+        for (const ThreadCounts* counts : liveCounts) total.add(*counts);
+    }
+};
+
+static Metrics metrics;
+
+/***************************************************************
+ * ThreadCountsSlot Struct
+ *
+ * The thread_local owner of one thread's ThreadCounts: it registers them with metrics when the thread first records,
+ * and on thread exit adds them to the retired total and unregisters them, so short-lived threads leave nothing behind.
+ ***************************************************************/
+struct ThreadCountsSlot {
+    ThreadCounts counts;
+
+    ThreadCountsSlot() {
+        lock_guard<mutex> guard(metrics.threadCountsLock);
+        metrics.liveCounts.push_back(&counts);
+    }
+
+    ~ThreadCountsSlot() {
+        lock_guard<mutex> guard(metrics.threadCountsLock);
+        metrics.retiredCounts.add(counts);
+        metrics.liveCounts.erase(find(metrics.liveCounts.begin(), metrics.liveCounts.end(), &counts));
+    }
+};
+
+inline ThreadCounts& Metrics::local() {
+    thread_local ThreadCountsSlot slot;
+    return slot.counts;
+}
+
+/***************************************************************
+ * OutputBuffer Class
+ *
+ * Collects program output in one large reusable buffer and writes it to the stream in big chunks, instead of
+ * flushing after every line with endl. The text is exactly what the equivalent cout statements would print.
+ * Output reaches the stream when the buffer fills or on flush(); main flushes at the end of every command,
+ * and code that reads input (or writes to cout directly) mid-command flushes first so the order is kept.
+ ***************************************************************/
+class OutputBuffer {
+public:
+    explicit OutputBuffer(ostream& out) : out(out) {
+        buffer.reserve(capacity);
+    }
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    OutputBuffer& operator<<(string_view text) {
+        if (buffer.size() + text.size() > capacity) flush();
+        buffer.append(text.data(), text.size());
+        return *this;
+    }
+
+    OutputBuffer& operator<<(char c) {
+        if (buffer.size() >= capacity) flush();
+        buffer.push_back(c);
+        return *this;
+    }
+
+    // Integers are formatted with to_chars, which gives the same digits as operator<< on an ostream
+    template <typename Integer, typename = enable_if_t<is_integral_v<Integer>>>
+    OutputBuffer& operator<<(Integer value) {
+        char digits[24];
+        to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    // %g matches an ostream's default floating-point format (six significant digits)
+    OutputBuffer& operator<<(double value) {
+        char digits[32];
+        int length = snprintf(digits, sizeof(digits), "%g", value);
+        return *this << string_view(digits, static_cast<size_t>(length));
+    }
+
+    // Writes everything buffered so far in one call and flushes the stream
+    void flush() {
+        if (!buffer.empty()) {
+            out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+            buffer.clear();
+        }
+        out.flush();
+    }
+
+private:
+    static constexpr size_t capacity = 64 * 1024;
+
+    ostream& out;
+    string buffer;
+};
+
+// All listings and query answers go through this buffer
+static OutputBuffer bufferedOut(cout);
+
+/***************************************************************
+ * StringOutput Struct
+ *
+ * Appends to a string with the same << calls as an OutputBuffer, so a response can be formatted once and kept
+ * (see ResponseCache) instead of going straight to the stream.
+ ***************************************************************/
+struct StringOutput {
+    string& text;
+
+    StringOutput& operator<<(string_view value) {
+        text.append(value.data(), value.size());
+        return *this;
+    }
+
+    StringOutput& operator<<(char c) {
+        text.push_back(c);
+        return *this;
+    }
+
+    // Integers are formatted with to_chars, as OutputBuffer does
+    template <typename Integer, typename = enable_if_t<is_integral_v<Integer>>>
+    StringOutput& operator<<(Integer value) {
+        char digits[24];
+        to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+};
+
+/***************************************************************
+ * StringPool Class
+ *
+ * Intern pool for course numbers, names and prerequisite references. Each distinct string is stored once,
+ * in large contiguous blocks, as a 4-byte length followed by its characters; the address of that record identifies
+ * the string for as long as the pool lives, so two strings interned in the same pool are equal exactly when their
+ * records are. The pool is split into shards by hash, each with its own lock and table, so the parallel loader's
+ * threads rarely wait on each other. Tables hold bare record pointers (up to 3/4 full) to keep the per-string overhead small.
+ *
+ * New InternedStrings go into the active pool. That is the process pool unless a Scope makes another one active:
+ * the menu keeps its one catalog in the process pool for the whole run (a reload only adds the strings that changed),
+ * while each QueryCatalog loads into a pool of its own, so a server frees a catalog version's strings along with it.
+ * A pool frees nothing before it is destroyed.
+ ***************************************************************/
+class StringPool {
+private:
+    static constexpr size_t shardBits = 6;
+    static constexpr size_t shardCount = size_t(1) << shardBits;
+    static constexpr size_t blockSize = 256 * 1024;
+
+    struct Shard {
+        mutex lock;
+        // Open-addressing table of the records in this shard (nullptr marks a free slot)
+        vector<const char*> table;
+        size_t count = 0;
+        // Storage for the records; a block is never moved or freed, so records stay where they are
+        vector<unique_ptr<char[]>> blocks;
+        char* cursor = nullptr;
+        size_t remaining = 0;
+        size_t blockBytes = 0;
+
+        // Copies text into the shard's storage as a new record, keeping records 4-byte aligned
+        const char* store(string_view text) {
+            size_t recordSize = (sizeof(uint32_t) + text.size() + 3) & ~size_t(3);
+            if (recordSize > remaining) {
+                size_t size = max(blockSize, recordSize);
+                // Left uninitialized, so a block's pages only become resident as records fill them
+                blocks.emplace_back(new char[size]);
+                cursor = blocks.back().get();
+                remaining = size;
+                blockBytes += size;
+            }
+            uint32_t length = static_cast<uint32_t>(text.size());
+            memcpy(cursor, &length, sizeof(length));
+            memcpy(cursor + sizeof(length), text.data(), text.size());
+            const char* record = cursor;
+            cursor += recordSize;
+            remaining -= recordSize;
+            return record;
+        }
+
+        void grow() {
+            vector<const char*> larger(max<size_t>(64, table.size() * 2), nullptr);
+            size_t mask = larger.size() - 1;
+            for (const char* record : table) {
+                if (!record) continue;
+                size_t i = hash<string_view>{}(textOf(record)) & mask;
+                while (larger[i]) i = (i + 1) & mask;
+                larger[i] = record;
+            }
+            table.swap(larger);
+        }
+    };
+
+    Shard shards[shardCount];
+
+    // The pool new InternedStrings are interned in
+    static atomic<StringPool*>& activePool() {
+        static atomic<StringPool*> pool{ &processPool() };
+        return pool;
+    }
+
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    // The pool used when no Scope is active; it lives for the whole run
+    static StringPool& processPool() {
+        static StringPool pool;
+        return pool;
+    }
+
+    // The pool every new InternedString comes from
+    static StringPool& active() {
+        return *activePool().load(memory_order_acquire);
+    }
+
+    // Makes pool the active one until the scope ends. The pool is shared by every thread (the parallel loader's
+    // included), so only one Scope may be open at a time, and only while no other thread interns strings.
+    class Scope {
+    private:
+        StringPool* previous;
+
+    public:
+        explicit Scope(StringPool& pool) : previous(activePool().exchange(&pool, memory_order_acq_rel)) {}
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() {
+            activePool().store(previous, memory_order_release);
+        }
+    };
+
+    // The record of the empty string, shared by every empty InternedString
+    static const char* emptyRecord() {
+        alignas(uint32_t) static const char record[sizeof(uint32_t)] = {};
+        return record;
+    }
+
+    // The text of a record
+    static string_view textOf(const char* record) {
+        uint32_t length;
+        memcpy(&length, record, sizeof(length));
+        return string_view(record + sizeof(length), length);
+    }
+
+    // Returns the record for text, adding it if it isn't pooled yet
+    const char* intern(string_view text) {
+        if (text.empty()) return emptyRecord();
+
+        size_t hashValue = hash<string_view>{}(text);
+        // The low bits pick the slot inside a shard, so the shard comes from the high bits (of a 32- or 64-bit size_t)
+        Shard& shard = shards[hashValue >> (numeric_limits<size_t>::digits - shardBits)];
+        lock_guard<mutex> guard(shard.lock);
+        if (4 * (shard.count + 1) > 3 * shard.table.size()) shard.grow();
+
+        size_t mask = shard.table.size() - 1;
+        size_t i = hashValue & mask;
+        while (shard.table[i]) {
+            if (textOf(shard.table[i]) == text) return shard.table[i];
+            i = (i + 1) & mask;
+        }
+        shard.table[i] = shard.store(text);
+        ++shard.count;
+        return shard.table[i];
+    }
+
+    // Number of distinct strings in the pool
+    size_t size() {
+        size_t total = 0;
+        for (Shard& shard : shards) {
+            lock_guard<mutex> guard(shard.lock);
+            total += shard.count;
+        }
+        return total;
+    }
+
+    // Bytes of record storage the pool has allocated
+    size_t storageBytes() {
+        size_t total = 0;
+        for (Shard& shard : shards) {
+            lock_guard<mutex> guard(shard.lock);
+            total += shard.blockBytes;
+        }
+        return total;
+    }
+};
+
+/***************************************************************
+ * InternedString Struct
+ *
+ * A string held in a StringPool: one pointer to its pooled record, instead of a 32-byte std::string and its own heap buffer.
+ * Assigning any text to one interns it in the active pool, which must outlive it. Comparing two InternedStrings
+ * for equality compares pointers (so both must come from the same pool, as a catalog's strings do); ordering, and
+ * comparing with plain text, compare the characters. Converts to string_view wherever text is read.
+ ***************************************************************/
+struct InternedString {
+    const char* record;
+
+    InternedString() : record(StringPool::emptyRecord()) {}
+    InternedString(string_view value) : record(StringPool::active().intern(value)) {}
+    InternedString(const string& value) : InternedString(string_view(value)) {}
+    InternedString(const char* value) : InternedString(string_view(value)) {}
+
+    string_view view() const {
+        return StringPool::textOf(record);
+    }
+
+    operator string_view() const {
+        return view();
+    }
+
+    const char* data() const {
+        return record + sizeof(uint32_t);
+    }
+
+    size_t size() const {
+        return view().size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    friend bool operator==(const InternedString& a, const InternedString& b) {
+        return a.record == b.record;
+    }
+
+    friend bool operator!=(const InternedString& a, const InternedString& b) {
+        return a.record != b.record;
+    }
+
+    friend bool operator==(const InternedString& a, string_view b) {
+        return a.view() == b;
+    }
+
+    friend bool operator<(const InternedString& a, const InternedString& b) {
+        return a.view() < b.view();
+    }
+
+    friend ostream& operator<<(ostream& out, const InternedString& value) {
+        return out << value.view();
+    }
+};
+
+/***************************************************************
+ * Course Struct
+ *
+ * Represents a single course, storing:
+ * - courseNumber
+ * - courseName
+ * - prerequisites (list of courseNumbers)
+ * - prerequisiteLinks (the course each prerequisite refers to, filled in by CourseBST::resolvePrerequisites)
+ * The strings are interned, so a prerequisite named by many courses is stored once.
+ ***************************************************************/
+struct Course {
+    InternedString courseNumber;
+    InternedString courseName;
+    vector<InternedString> prerequisites;
+    // One entry per prerequisite: the course it names, or nullptr if that course isn't in the catalog
+    vector<const Course*> prerequisiteLinks;
+    // Position of this course in sorted order, assigned by CourseBST::resolvePrerequisites
+    size_t id = 0;
+    // Hash of the CSV line this course was parsed from, so a reload can tell whether the row changed
+    uint64_t rowHash = 0;
+
+    // Helper method to print just the course number and course name
+    void printCourseBasic() const {
+        bufferedOut << courseNumber << ", " << courseName << '\n';
+    }
+};
+
+/***************************************************************
+ * Packed course keys
+ *
+ * packCourseKey packs the first eight bytes of a courseNumber into a 64-bit integer, big-endian and zero-padded,
+ * so comparing two packed keys gives the same order as comparing the strings whenever the keys differ.
+ * Typical course numbers ("CSCI300", "MATH201") fit entirely, so a comparison is one integer compare;
+ * only keys that share their first eight bytes fall back to comparing the strings.
+ ***************************************************************/
+inline uint64_t packCourseKey(string_view courseNumber) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        unsigned char byte = i < courseNumber.size() ? static_cast<unsigned char>(courseNumber[i]) : 0;
+        key = (key << 8) | byte;
+    }
+    return key;
+}
+
+// Three-way comparison of two courseNumbers given their packed keys. The texts are taken as they are
+// (an InternedString or a string_view) and only read when the keys tie, so a decided comparison never touches them.
+template <typename TextA, typename TextB>
+inline int compareCourseKeys(uint64_t keyA, const TextA& a, uint64_t keyB, const TextB& b) {
+    if (keyA != keyB) return keyA < keyB ? -1 : 1;
+    return string_view(a).compare(string_view(b));
+}
+
+/***************************************************************
+ * Node Struct
+ *
+ * A node in the binary search tree (BST). It contains one Course, plus pointers to its left and right child nodes.
+ * Each node also records the height of its subtree so the tree can rebalance itself (AVL).
+ * The packed key and the links come first, so walking down the tree reads one small header per node
+ * and never touches the course itself until the search ends.
+ ***************************************************************/
+struct Node {
+    // packCourseKey(course.courseNumber)
+    uint64_t key;
+    // Pointer to left child in the BST
+    Node* left;
+    // Pointer to right child in the BST
+    Node* right;
+    // Height of the subtree rooted here (a leaf has height 1)
+    int height;
+    // The actual course data
+    Course course;
+
+    // Constructors for convenience: copy a course, take ownership of one, or build it in place
+    Node(const Course& c) : key(packCourseKey(c.courseNumber)), left(nullptr), right(nullptr), height(1), course(c) {}
+    Node(Course&& c) : key(packCourseKey(c.courseNumber)), left(nullptr), right(nullptr), height(1), course(move(c)) {}
+    template <typename... Args>
+    explicit Node(in_place_t, Args&&... args) : key(0), left(nullptr), right(nullptr), height(1), course{ forward<Args>(args)... } {
+        key = packCourseKey(course.courseNumber);
+    }
+
+    // Three-way comparison of this node's courseNumber against another key
+    int compareTo(uint64_t otherKey, string_view other) const {
+        return compareCourseKeys(key, course.courseNumber, otherKey, other);
+    }
+};
+
+/***************************************************************
+ * NodeArena Class
+ *
+ * Owns the memory for every Node of one CourseBST. Nodes are carved out of large blocks by bumping an index,
+ * so neighbouring allocations sit next to each other in memory, and a bulk build can reserve one block for the whole catalog.
+ * Blocks start small and double in size (up to a cap) as the tree grows.
+ *
+ * Teardown is one bulk operation: releaseAll() runs the destructors in a single linear sweep over each block
+ * (the strings inside a Course still need it) and then returns each block to the heap in one call.
+ * A node removed from the tree is recycled instead: recycle() empties it and puts it on a free list (threaded through
+ * its left pointer), and the next create() reuses it. Recycled nodes stay constructed, so the sweep stays uniform.
+ ***************************************************************/
+class NodeArena {
+private:
+    // One contiguous run of node slots; slots [0, used) hold constructed nodes
+    struct Block {
+        Node* nodes;
+        size_t used;
+        size_t capacity;
+    };
+
+    // Size of the first block, and the largest block size that growth alone will produce
+    static constexpr size_t firstBlockSize = 256;
+    static constexpr size_t maxBlockSize = 65536;
+
+    // Every block owned by the arena; new nodes come from the last one
+    vector<Block> blocks;
+    // Capacity of the next block to allocate when the current one fills up
+    size_t nextBlockSize;
+    // Nodes in use (constructed and not recycled) across all blocks
+    size_t nodeCount;
+    // Recycled nodes waiting to be reused, linked through their left pointers
+    Node* freeList;
+
+public:
+    NodeArena() : nextBlockSize(firstBlockSize), nodeCount(0), freeList(nullptr) {}
+
+    // The arena owns raw memory, so it can't be copied
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    ~NodeArena() {
+        releaseAll();
+    }
+
+    // Makes sure the next count nodes can be bump-allocated from one contiguous block
+    void reserve(size_t count) {
+        if (!blocks.empty() && blocks.back().capacity - blocks.back().used >= count) return;
+
+        size_t capacity = max(count, nextBlockSize);
+        Node* nodes = static_cast<Node*>(::operator new(capacity * sizeof(Node)));
+        blocks.push_back({ nodes, 0, capacity });
+        nextBlockSize = min(nextBlockSize * 2, maxBlockSize);
+    }
+
+    // Constructs a node in the next free slot, forwarding the arguments to the Node constructor
+    template <typename... Args>
+    Node* create(Args&&... args) {
+        // Reuse a recycled node first
+        if (freeList) {
+            Node* node = freeList;
+            freeList = node->left;
+            *node = Node(forward<Args>(args)...);
+            ++nodeCount;
+            return node;
+        }
+
+        reserve(1);
+        Block& block = blocks.back();
+        Node* node = new (block.nodes + block.used) Node(forward<Args>(args)...);
+        ++block.used;
+        ++nodeCount;
+        return node;
+    }
+
+    // Empties a node that has left the tree and keeps it for the next create()
+    void recycle(Node* node) {
+        node->course = Course();
+        node->right = nullptr;
+        node->left = freeList;
+        freeList = node;
+        --nodeCount;
+    }
+
+    // Destroys every node and hands all blocks back to the heap
+    void releaseAll() {
+        for (auto& block : blocks) {
+            for (size_t i = 0; i < block.used; ++i) {
+                block.nodes[i].~Node();
+            }
+            ::operator delete(block.nodes);
+        }
+        blocks.clear();
+        nextBlockSize = firstBlockSize;
+        nodeCount = 0;
+        freeList = nullptr;
+    }
+
+    // Number of nodes currently allocated from the arena
+    size_t size() const {
+        return nodeCount;
+    }
+};
+
+/***************************************************************
+ * CourseNumberLess
+ *
+ * Orders courses by courseNumber and counts how many comparisons were made, so the load modes can be compared.
+ ***************************************************************/
+struct CourseNumberLess {
+    // Counter owned by the caller (one per thread when sorting in parallel)
+    size_t* comparisons;
+
+    bool operator()(const Course& a, const Course& b) const {
+        ++*comparisons;
+        return a.courseNumber < b.courseNumber;
+    }
+};
+
+/***************************************************************
+ * SortEntry / SortEntryLess
+ *
+ * What sortCourses actually sorts: a course's packed key and its position, 16 bytes instead of a whole Course.
+ * Entries compare by packed key, falling back to the courses' strings only when the keys tie.
+ ***************************************************************/
+struct SortEntry {
+    uint64_t key;
+    size_t index;
+};
+
+struct SortEntryLess {
+    const vector<Course>* courses;
+    // Counter owned by the caller (one per thread when sorting in parallel)
+    size_t* comparisons;
+
+    bool operator()(const SortEntry& a, const SortEntry& b) const {
+        ++*comparisons;
+        return compareCourseKeys(a.key, (*courses)[a.index].courseNumber, b.key, (*courses)[b.index].courseNumber) < 0;
+    }
+};
+
+/***************************************************************
+ * runInParallel
+ *
+ * Runs task(0) ... task(taskCount - 1) at the same time, one thread each (the calling thread runs task 0),
+ * and returns once every task has finished.
+ ***************************************************************/
+template <typename Task>
+void runInParallel(size_t taskCount, Task task) {
+    vector<thread> workers;
+    for (size_t i = 1; i < taskCount; ++i) {
+        workers.emplace_back(task, i);
+    }
+    if (taskCount > 0) task(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Below this many courses per slice, thread startup costs more than it saves
+const size_t minSliceSize = 16384;
+
+/***************************************************************
+ * sliceCountFor
+ *
+ * How many slices to cut itemCount courses into for runInParallel: one per hardware thread,
+ * but never so many that a slice falls below minSliceSize (and always at least one).
+ ***************************************************************/
+size_t sliceCountFor(size_t itemCount) {
+    size_t hardwareThreads = max(1u, thread::hardware_concurrency());
+    return min(hardwareThreads, max<size_t>(1, itemCount / minSliceSize));
+}
+
+/***************************************************************
+ * sortCourses
+ *
+ * Stable-sorts courses by courseNumber so duplicate keys keep their file order.
+ * The sort runs over (packed key, position) entries, so comparisons are integer compares on a compact array
+ * and each Course is moved once at the end instead of at every step.
+ * Large inputs are cut into one slice per hardware thread; the slices are sorted in parallel and then merged pairwise.
+ * Returns the number of courseNumber comparisons performed.
+ ***************************************************************/
+size_t sortCourses(vector<Course>& courses) {
+    size_t sliceCount = sliceCountFor(courses.size());
+
+    // Slice i covers [bounds[i], bounds[i + 1])
+    vector<size_t> bounds;
+    for (size_t i = 0; i <= sliceCount; ++i) {
+        bounds.push_back(courses.size() * i / sliceCount);
+    }
+
+    // One comparison counter per slice so threads never share a counter
+    vector<size_t> counters(sliceCount, 0);
+
+    vector<SortEntry> entries(courses.size());
+    for (size_t i = 0; i < courses.size(); ++i) {
+        entries[i] = SortEntry{ packCourseKey(courses[i].courseNumber), i };
+    }
+
+    // Sort each slice on its own thread
+    runInParallel(sliceCount, [&](size_t i) {
+        stable_sort(entries.begin() + bounds[i], entries.begin() + bounds[i + 1], SortEntryLess{ &courses, &counters[i] });
+    });
+
+    // Merge neighbouring slices until one sorted run is left; each round's merges are independent
+    for (size_t width = 1; width < sliceCount; width *= 2) {
+        size_t mergeCount = (sliceCount - width + 2 * width - 1) / (2 * width);
+        runInParallel(mergeCount, [&](size_t m) {
+            size_t i = m * 2 * width;
+            size_t first = bounds[i];
+            size_t middle = bounds[i + width];
+            size_t last = bounds[min(i + 2 * width, sliceCount)];
+            inplace_merge(entries.begin() + first, entries.begin() + middle, entries.begin() + last,
+                SortEntryLess{ &courses, &counters[i] });
+        });
+    }
+
+    // Move every course to its sorted position
+    vector<Course> sorted;
+    sorted.reserve(courses.size());
+    for (const SortEntry& entry : entries) {
+        sorted.push_back(move(courses[entry.index]));
+    }
+    courses.swap(sorted);
+
+    size_t total = 0;
+    for (size_t count : counters) {
+        total += count;
+    }
+    return total;
+}
+
+/***************************************************************
+ * CourseHashIndex Class
+ *
+ * A flat open-addressing hash table from courseNumber to the Course stored in the tree, used for point lookups.
+ * Each slot holds the key's precomputed 64-bit hash next to the Course pointer, so a probe compares hashes first
+ * and only touches the course's string on a hash match. Collisions are resolved by linear probing over the slot array,
+ * and the table doubles before it gets more than half full, so probe runs stay short and stay within a cache line or two.
+ * erase() uses backward-shift deletion, so the table never fills up with tombstones.
+ ***************************************************************/
+class CourseHashIndex {
+private:
+    // One table entry; course is nullptr for an empty slot
+    struct Slot {
+        uint64_t hash;
+        Course* course;
+    };
+
+    // Smallest table allocated once anything is inserted
+    static constexpr size_t minCapacity = 16;
+
+    // The table itself; its size is always zero or a power of two
+    vector<Slot> slots;
+    // Number of occupied slots
+    size_t count;
+
+    // Places an entry into a table known to have room and no equal key
+    static void place(vector<Slot>& table, const Slot& entry) {
+        size_t mask = table.size() - 1;
+        size_t i = entry.hash & mask;
+        while (table[i].course) {
+            i = (i + 1) & mask;
+        }
+        table[i] = entry;
+    }
+
+    // Moves every entry into a table of the given capacity
+    void rehash(size_t capacity) {
+        vector<Slot> table(capacity, Slot{ 0, nullptr });
+        for (const auto& slot : slots) {
+            if (slot.course) place(table, slot);
+        }
+        slots.swap(table);
+    }
+
+public:
+    CourseHashIndex() : count(0) {}
+
+    // Hashes a course number (FNV-1a, then a final mix so the low bits used for the slot index are well spread)
+    static uint64_t hashKey(string_view key) {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : key) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // Removes every entry
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    // Sizes the table so it can hold n entries without growing
+    void reserve(size_t n) {
+        size_t capacity = minCapacity;
+        while (capacity < 2 * n) capacity *= 2;
+        if (capacity > slots.size()) rehash(capacity);
+    }
+
+    // Adds the course under its courseNumber. If that courseNumber is already indexed, the existing entry is
+    // kept (so lookups return the course that was inserted first) and false is returned.
+    bool insert(Course* course) {
+        if (2 * (count + 1) > slots.size()) {
+            rehash(max(minCapacity, 2 * slots.size()));
+        }
+
+        uint64_t hash = hashKey(course->courseNumber);
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i].course) {
+            if (slots[i].hash == hash && slots[i].course->courseNumber == course->courseNumber) {
+                return false;
+            }
+            i = (i + 1) & mask;
+        }
+        slots[i] = Slot{ hash, course };
+        ++count;
+        return true;
+    }
+
+    // Removes the entry for this courseNumber; returns false if there wasn't one
+    bool erase(string_view courseNumber) {
+        if (slots.empty()) return false;
+
+        uint64_t hash = hashKey(courseNumber);
+        size_t mask = slots.size() - 1;
+        size_t hole = hash & mask;
+        while (slots[hole].course && !(slots[hole].hash == hash && slots[hole].course->courseNumber == courseNumber)) {
+            hole = (hole + 1) & mask;
+        }
+        if (!slots[hole].course) return false;
+
+        // Pull later entries of the probe run back into the hole, unless that would move one before its home slot
+        for (size_t j = (hole + 1) & mask; slots[j].course; j = (j + 1) & mask) {
+            size_t home = slots[j].hash & mask;
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                slots[hole] = slots[j];
+                hole = j;
+            }
+        }
+        slots[hole] = Slot{ 0, nullptr };
+        --count;
+        return true;
+    }
+
+    // Returns the course with this courseNumber, or nullptr if it isn't indexed
+    Course* find(string_view courseNumber) const {
+        size_t probes;
+        return find(courseNumber, probes);
+    }
+
+    // The same lookup, also counting the slots it examined (the final empty slot of a miss included) into probes
+    Course* find(string_view courseNumber, size_t& probes) const {
+        probes = 0;
+        if (slots.empty()) return nullptr;
+
+        uint64_t hash = hashKey(courseNumber);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            ++probes;
+            if (!slots[i].course) return nullptr;
+            if (slots[i].hash == hash && slots[i].course->courseNumber == courseNumber) return slots[i].course;
+        }
+    }
+
+    // The same lookup for an interned key (such as a prerequisite): a hash match is confirmed by comparing pointers
+    Course* find(const InternedString& courseNumber) const {
+        if (slots.empty()) return nullptr;
+
+        uint64_t hash = hashKey(courseNumber);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; slots[i].course; i = (i + 1) & mask) {
+            if (slots[i].hash == hash && slots[i].course->courseNumber == courseNumber) {
+                return slots[i].course;
+            }
+        }
+        return nullptr;
+    }
+
+    // Number of distinct courseNumbers indexed
+    size_t size() const {
+        return count;
+    }
+};
+
+/***************************************************************
+ * DanglingPrerequisite Struct
+ *
+ * A prerequisite that names a course not in the catalog: course->prerequisites[index] is the missing courseNumber.
+ ***************************************************************/
+struct DanglingPrerequisite {
+    const Course* course;
+    size_t index;
+};
+
+/***************************************************************
+ * AvlBalancer Class
+ *
+ * The AVL height bookkeeping and rotations, written once for any node layout. Links tells it how to reach a node's
+ * children and height: it names the node handle type (Ref), the handle of an empty subtree (null()), and returns
+ * references to left(node), right(node) and height(node). CourseBST links Nodes by pointer; AvlIndex links array
+ * entries by index. Both rebalance with the same code, so the two trees can't drift apart.
+ ***************************************************************/
+template <typename Links>
+class AvlBalancer {
+public:
+    using Ref = typename Links::Ref;
+
+    explicit AvlBalancer(Links links = Links()) : links(links) {}
+
+    // Returns the height of a subtree (an empty subtree has height 0)
+    int heightOf(Ref node) const {
+        return node == links.null() ? 0 : links.height(node);
+    }
+
+    // Recomputes a node's height from its children
+    void updateHeight(Ref node) const {
+        links.height(node) = 1 + max(heightOf(links.left(node)), heightOf(links.right(node)));
+    }
+
+    // Left subtree height minus right subtree height
+    int balanceOf(Ref node) const {
+        return heightOf(links.left(node)) - heightOf(links.right(node));
+    }
+
+    // Rotates the subtree right so the left child becomes its new root
+    void rotateRight(Ref& node) const {
+        Ref pivot = links.left(node);
+        links.left(node) = links.right(pivot);
+        links.right(pivot) = node;
+        updateHeight(node);
+        updateHeight(pivot);
+        node = pivot;
+    }
+
+    // Rotates the subtree left so the right child becomes its new root
+    void rotateLeft(Ref& node) const {
+        Ref pivot = links.right(node);
+        links.right(node) = links.left(pivot);
+        links.left(pivot) = node;
+        updateHeight(node);
+        updateHeight(pivot);
+        node = pivot;
+    }
+
+    // Restores the AVL property at this node after one of its subtrees changed height
+    void rebalance(Ref& node) const {
+        updateHeight(node);
+        int balance = balanceOf(node);
+
+        // Left-heavy: single right rotation, or left-right double rotation
+        if (balance > 1) {
+            if (balanceOf(links.left(node)) < 0) {
+                rotateLeft(links.left(node));
+            }
+            rotateRight(node);
+        }
+        // Right-heavy: single left rotation, or right-left double rotation
+        else if (balance < -1) {
+            if (balanceOf(links.right(node)) > 0) {
+                rotateRight(links.right(node));
+            }
+            rotateLeft(node);
+        }
+    }
+
+private:
+    Links links;
+};
+
+/***************************************************************
+ * NodeLinks Struct
+ *
+ * AvlBalancer's view of the tree Nodes: linked by pointer, with nullptr for an empty subtree.
+ ***************************************************************/
+struct NodeLinks {
+    using Ref = Node*;
+
+    static Node* null() {
+        return nullptr;
+    }
+
+    static Node*& left(Node* node) {
+        return node->left;
+    }
+
+    static Node*& right(Node* node) {
+        return node->right;
+    }
+
+    static int& height(Node* node) {
+        return node->height;
+    }
+};
+
+/***************************************************************
+ * CourseBST Class
+ *
+ * A self-balancing (AVL) binary search tree keyed by courseNumber in alphanumeric order. Each courseNumber appears at most once. Provides:
+ *   - insert (Course)
+ *   - bulkLoad (vector of Courses, sorted once and built bottom-up)
+ *   - erase (courseNumber)
+ *   - printAll() (in-order traversal)
+ *   - search (courseNumber), and searchTree to find it by descending the tree instead
+ *   - begin/end, lowerBound/upperBound (in-order iteration over all or part of the tree)
+ *
+ * The tree keeps the courses in order for printAll. Alongside it, a CourseHashIndex over the same courses answers
+ * search() in O(1); both are updated together by every insert and bulk load.
+ *
+ * After loading, resolvePrerequisites() links every prerequisite to the course it names and numbers the courses
+ * in sorted order, so queries can follow the links instead of searching.
+ *
+ * All nodes live in a NodeArena owned by the tree, so cleanup is one bulk release when the tree is destroyed.
+ *
+ * After every insert the heights of the left and right subtrees of any node differ by at most one,
+ * so the tree height stays below 1.44 * log2(n) even when the CSV arrives already sorted.
+ * This keeps search at O(log n) and bounds the depth of every recursive helper by the tree height.
+ ***************************************************************/
+class CourseBST {
+private:
+    // The root node of the BST
+    Node* root;
+    // Owns the memory of every node in the tree
+    NodeArena arena;
+    // Point-lookup index over the courses in the nodes (nodes never move, so the pointers stay valid)
+    CourseHashIndex index;
+    // Every course by id (its position in sorted order), filled in by resolvePrerequisites
+    vector<Course*> courseById;
+    // Prerequisites naming a course that isn't in the tree, found by the last resolvePrerequisites
+    vector<DanglingPrerequisite> dangling;
+    // True while every course's prerequisiteLinks and id match the current contents of the tree
+    bool resolved;
+    // Number of courseNumber comparisons made while building the tree (for comparing load modes)
+    size_t comparisons;
+
+    // Height bookkeeping and rotations, shared with AvlIndex
+    static int heightOf(Node* node) {
+        return AvlBalancer<NodeLinks>().heightOf(node);
+    }
+
+    static void updateHeight(Node* node) {
+        AvlBalancer<NodeLinks>().updateHeight(node);
+    }
+
+    static void rebalance(Node*& node) {
+        AvlBalancer<NodeLinks>().rebalance(node);
+    }
+
+    // Recursively links an already-built node into the BST by courseNumber, rebalancing on the way back up.
+    // Recursion depth is bounded by the tree height, which is O(log n).
+    void addNode(Node*& node, Node* fresh) {
+        // If position is empty, place the new node here
+        if (!node) {
+            node = fresh;
+            return;
+        }
+        // Or compare courseNumber to decide left or right subtree
+        ++comparisons;
+        if (node->compareTo(fresh->key, fresh->course.courseNumber) > 0) {
+            addNode(node->left, fresh);
+        }
+        else {
+            addNode(node->right, fresh);
+        }
+
+        // Fix up heights and rotate if this subtree became unbalanced
+        rebalance(node);
+    }
+
+    // Detaches the leftmost node of a non-empty subtree and returns it, rebalancing on the way back up
+    static Node* detachMin(Node*& node) {
+        if (!node->left) {
+            Node* minimum = node;
+            node = node->right;
+            return minimum;
+        }
+        Node* minimum = detachMin(node->left);
+        rebalance(node);
+        return minimum;
+    }
+
+    // Recursively unlinks the node with this courseNumber (and packed key) and returns it (nullptr if there is none).
+    // Nodes are relinked rather than having their courses swapped, so pointers to the remaining courses stay valid.
+    Node* removeNode(Node*& node, uint64_t key, string_view courseNumber) {
+        if (!node) return nullptr;
+
+        Node* removed;
+        int order = node->compareTo(key, courseNumber);
+        if (order > 0) {
+            removed = removeNode(node->left, key, courseNumber);
+        }
+        else if (order < 0) {
+            removed = removeNode(node->right, key, courseNumber);
+        }
+        else {
+            removed = node;
+            if (!node->left) {
+                node = node->right;
+            }
+            else if (!node->right) {
+                node = node->left;
+            }
+            else {
+                // Two children: the in-order successor takes the removed node's place
+                Node* successor = detachMin(node->right);
+                successor->left = removed->left;
+                successor->right = removed->right;
+                node = successor;
+            }
+        }
+
+        if (node) rebalance(node);
+        return removed;
+    }
+
+    // Adds a freshly created node to both the tree and the hash index
+    void linkNode(Node* node) {
+        addNode(root, node);
+        index.insert(&node->course);
+        resolved = false;
+    }
+
+    // Links the sorted nodes[lo, hi) into a perfectly balanced subtree and returns its root.
+    // Each node is visited once, so the whole build is O(n); recursion depth is log2(n).
+    static Node* buildBalanced(const vector<Node*>& nodes, size_t lo, size_t hi) {
+        // Empty run => empty subtree
+        if (lo >= hi) return nullptr;
+
+        // The middle node becomes the root, each half becomes a child subtree
+        size_t mid = lo + (hi - lo) / 2;
+        Node* node = nodes[mid];
+        node->left = buildBalanced(nodes, lo, mid);
+        node->right = buildBalanced(nodes, mid + 1, hi);
+        updateHeight(node);
+        return node;
+    }
+
+    // Recursively calls visit(node) on every node in sorted order (depth is bounded by the tree height)
+    template <typename Visitor>
+    static void visitInOrder(Node* node, Visitor& visit) {
+        if (!node) return;
+        visitInOrder(node->left, visit);
+        visit(node);
+        visitInOrder(node->right, visit);
+    }
+
+    // Recursively moves every course out of the tree, in sorted order, into the output vector
+    static void collectInOrder(Node* node, vector<Course>& out) {
+        if (!node) return;
+        collectInOrder(node->left, out);
+        out.push_back(move(node->course));
+        collectInOrder(node->right, out);
+    }
+
+public:
+    // Walks the tree in sorted order without recursion. The iterator keeps the path of nodes still to visit on a fixed
+    // stack (the current course on top), so ++ is amortized O(1) and never allocates; an AVL tree's height stays under
+    // 1.44 * log2(n + 2), far below maxDepth for any tree that fits in memory. Inserting or erasing invalidates iterators.
+    class Iterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = Course;
+        using difference_type = ptrdiff_t;
+        using pointer = const Course*;
+        using reference = const Course&;
+
+        // An empty stack is the end of the tree
+        Iterator() : depth(0) {}
+
+        reference operator*() const {
+            return path[depth - 1]->course;
+        }
+
+        pointer operator->() const {
+            return &path[depth - 1]->course;
+        }
+
+        // Moves to the next course: the leftmost course of the right subtree, or else the nearest waiting ancestor
+        Iterator& operator++() {
+            const Node* node = path[--depth];
+            pushLeftSpine(node->right);
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return current() == other.current();
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return current() != other.current();
+        }
+
+    private:
+        friend class CourseBST;
+
+        static constexpr size_t maxDepth = 64;
+
+        // Ancestors whose course comes after the current one, nearest on top
+        const Node* path[maxDepth];
+        size_t depth;
+
+        const Node* current() const {
+            return depth ? path[depth - 1] : nullptr;
+        }
+
+        void push(const Node* node) {
+            path[depth++] = node;
+        }
+
+        void pushLeftSpine(const Node* node) {
+            for (; node; node = node->left) push(node);
+        }
+
+        // Positions the iterator on the first course whose courseNumber is not below key (or above it, when strict).
+        // Goes down one root-to-leaf path, keeping each node it turns left at, so it costs O(log n).
+        void seek(const Node* node, string_view key, bool strict) {
+            depth = 0;
+            uint64_t packed = packCourseKey(key);
+            ABCU_METRIC(size_t compared = 0);
+            while (node) {
+                ABCU_METRIC(++compared);
+                int order = node->compareTo(packed, key);
+                if (order > 0 || (order == 0 && !strict)) {
+                    push(node);
+                    node = node->left;
+                }
+                else {
+                    node = node->right;
+                }
+            }
+            ABCU_METRIC(metrics.local().seekComparisons.record(compared));
+        }
+    };
+
+    // Constructor initializes an empty BST
+    CourseBST() : root(nullptr), resolved(false), comparisons(0) {}
+
+    // The arena owns the nodes, so a tree can't be copied
+    CourseBST(const CourseBST&) = delete;
+    CourseBST& operator=(const CourseBST&) = delete;
+
+    // Inserts a copy of the course into the BST. Returns false (and changes nothing) if its courseNumber is already present.
+    bool insert(const Course& course) {
+        if (index.find(course.courseNumber)) return false;
+        linkNode(arena.create(course));
+        return true;
+    }
+
+    // Inserts the course into the BST, taking over its strings instead of copying them.
+    // Returns false (leaving course untouched) if its courseNumber is already present.
+    bool insert(Course&& course) {
+        if (index.find(course.courseNumber)) return false;
+        linkNode(arena.create(move(course)));
+        return true;
+    }
+
+    // Builds the course directly inside its tree node from the given members
+    // (courseNumber, courseName, prerequisites) and returns the stored course,
+    // or nullptr if its courseNumber is already present
+    template <typename... Args>
+    Course* emplace(Args&&... args) {
+        Node* node = arena.create(in_place, forward<Args>(args)...);
+        if (index.find(node->course.courseNumber)) {
+            arena.recycle(node);
+            return nullptr;
+        }
+        linkNode(node);
+        return &node->course;
+    }
+
+    // Removes the course with this courseNumber; returns false if there is none.
+    // Pointers to the removed course (including other courses' prerequisiteLinks) become invalid,
+    // so the tree needs resolvePrerequisites again before its links are used.
+    bool erase(string_view courseNumber) {
+        Node* removed = removeNode(root, packCourseKey(courseNumber), courseNumber);
+        if (!removed) return false;
+        index.erase(courseNumber);
+        arena.recycle(removed);
+        resolved = false;
+        return true;
+    }
+
+    // Removes every course
+    void clear() {
+        root = nullptr;
+        arena.releaseAll();
+        index.clear();
+        courseById.clear();
+        dangling.clear();
+        resolved = false;
+    }
+
+    // Sorts the courses once and rebuilds the tree bottom-up in O(n) from the sorted run.
+    // When a courseNumber appears more than once, the course already in the tree (or else the earliest one in courses) is kept,
+    // matching what insert() would have done. The courseNumbers of the courses dropped are appended to duplicates, if given.
+    void bulkLoad(vector<Course> courses, vector<string>* duplicates = nullptr) {
+        comparisons += sortCourses(courses);
+
+        // Fold any existing courses into the sorted run, then drop the old nodes in one release
+        if (root) {
+            vector<Course> existing;
+            existing.reserve(arena.size());
+            collectInOrder(root, existing);
+            arena.releaseAll();
+            root = nullptr;
+
+            vector<Course> merged;
+            merged.reserve(existing.size() + courses.size());
+            merge(make_move_iterator(existing.begin()), make_move_iterator(existing.end()),
+                make_move_iterator(courses.begin()), make_move_iterator(courses.end()),
+                back_inserter(merged), CourseNumberLess{ &comparisons });
+            courses.swap(merged);
+        }
+
+        // Allocate the nodes in sorted order from one block, so an in-order walk reads memory front to back.
+        // Equal courseNumbers are next to each other now, earliest first, so only the first of each run is kept.
+        arena.reserve(courses.size());
+        vector<Node*> nodes;
+        nodes.reserve(courses.size());
+        for (auto& course : courses) {
+            if (!nodes.empty() && nodes.back()->compareTo(packCourseKey(course.courseNumber), course.courseNumber) == 0) {
+                if (duplicates) duplicates->push_back(string(course.courseNumber));
+                continue;
+            }
+            nodes.push_back(arena.create(move(course)));
+        }
+        root = buildBalanced(nodes, 0, nodes.size());
+
+        // Re-index every course
+        index.clear();
+        index.reserve(nodes.size());
+        for (Node* node : nodes) {
+            index.insert(&node->course);
+        }
+        resolved = false;
+    }
+
+    // Links every prerequisite to the course it names (one hash lookup per prerequisite, done once after loading),
+    // numbers the courses 0..n-1 in sorted order, and records the prerequisites whose course is missing.
+    // Returns the dangling prerequisites, in course order.
+    const vector<DanglingPrerequisite>& resolvePrerequisites() {
+        courseById.clear();
+        courseById.reserve(arena.size());
+        dangling.clear();
+
+        auto resolve = [this](Node* node) {
+            Course& course = node->course;
+            course.id = courseById.size();
+            courseById.push_back(&course);
+
+            course.prerequisiteLinks.assign(course.prerequisites.size(), nullptr);
+            for (size_t i = 0; i < course.prerequisites.size(); ++i) {
+                course.prerequisiteLinks[i] = index.find(course.prerequisites[i]);
+                if (!course.prerequisiteLinks[i]) {
+                    dangling.push_back({ &course, i });
+                }
+            }
+        };
+        visitInOrder(root, resolve);
+
+        resolved = true;
+        return dangling;
+    }
+
+    // True if resolvePrerequisites has run since the tree last changed
+    bool prerequisitesResolved() const {
+        return resolved;
+    }
+
+    // Prerequisites found missing by the last resolvePrerequisites
+    const vector<DanglingPrerequisite>& danglingPrerequisites() const {
+        return dangling;
+    }
+
+    // Number of courses in the tree
+    size_t size() const {
+        return arena.size();
+    }
+
+    // The course with the given id (only valid while prerequisitesResolved() is true)
+    const Course& courseAt(size_t id) const {
+        return *courseById[id];
+    }
+
+    // First course in sorted order (end() when the tree is empty)
+    Iterator begin() const {
+        Iterator it;
+        it.pushLeftSpine(root);
+        return it;
+    }
+
+    // One past the last course
+    Iterator end() const {
+        return Iterator();
+    }
+
+    // First course whose courseNumber is >= key, in O(log n)
+    Iterator lowerBound(string_view key) const {
+        Iterator it;
+        it.seek(root, key, false);
+        return it;
+    }
+
+    // First course whose courseNumber is > key, in O(log n)
+    Iterator upperBound(string_view key) const {
+        Iterator it;
+        it.seek(root, key, true);
+        return it;
+    }
+
+    // Prints all courses in sorted order by courseNumber
+    void printAll() const {
+        for (const Course& course : *this) {
+            course.printCourseBasic();
+        }
+    }
+
+    // Height of the tree (0 when empty); stays O(log n) because the tree is balanced
+    int height() const {
+        return heightOf(root);
+    }
+
+    // Sum of every node's depth (the root is at depth 1), so totalDepth() / size() is the average search path length
+    size_t totalDepth() const {
+        size_t total = 0;
+        vector<pair<const Node*, size_t>> pending;
+        if (root) pending.push_back({ root, 1 });
+        while (!pending.empty()) {
+            auto [node, depth] = pending.back();
+            pending.pop_back();
+            total += depth;
+            if (node->left) pending.push_back({ node->left, depth + 1 });
+            if (node->right) pending.push_back({ node->right, depth + 1 });
+        }
+        return total;
+    }
+
+    // Number of courseNumber comparisons made while building this tree
+    size_t keyComparisons() const {
+        return comparisons;
+    }
+
+    // Returns a pointer to the course if found, otherwise nullptr (answered by the hash index)
+    Course* search(string_view courseNumber) const {
+        size_t probes;
+        Course* course = index.find(courseNumber, probes);
+        ABCU_METRIC(metrics.local().searchProbes.record(probes));
+        return course;
+    }
+
+    // Like search, but walks down the tree itself instead of asking the hash index: O(log n) comparisons
+    const Course* searchTree(string_view courseNumber) const {
+        uint64_t key = packCourseKey(courseNumber);
+        const Node* node = root;
+        while (node) {
+            int order = node->compareTo(key, courseNumber);
+            if (order == 0) return &node->course;
+            node = order > 0 ? node->left : node->right;
+        }
+        return nullptr;
+    }
+};
+
+/***************************************************************
+ * CourseIndex Class
+ *
+ * Common interface of the interchangeable lookup backends (see makeCourseIndex). A backend maps courseNumbers to
+ * courses owned elsewhere (by a resolved CourseBST), so one loaded catalog can be queried through any of them and
+ * the structures the Project One analysis compared can be measured side by side on the same data.
+ ***************************************************************/
+class CourseIndex {
+public:
+    virtual ~CourseIndex() = default;
+
+    // The name --backend selects it by
+    virtual const char* name() const = 0;
+
+    // Replaces the contents with sortedCourses, which must be in courseNumber order with no duplicates
+    virtual void build(const vector<const Course*>& sortedCourses) = 0;
+
+    // Adds one course; returns false (leaving the index unchanged) if its courseNumber is already present
+    virtual bool insert(const Course* course) = 0;
+
+    // The course with this courseNumber, or nullptr
+    virtual const Course* find(string_view courseNumber) const = 0;
+
+    virtual size_t size() const = 0;
+};
+
+/***************************************************************
+ * SortedVectorIndex Class
+ *
+ * Backend "sorted": one array of (packed key, course) entries in courseNumber order, searched by binary search.
+ * The most compact layout and O(log n) lookups, but insert() shifts everything after the new entry, so it is O(n).
+ ***************************************************************/
+class SortedVectorIndex : public CourseIndex {
+private:
+    struct Entry {
+        uint64_t key;
+        const Course* course;
+    };
+    vector<Entry> entries;
+
+    // Position of the first entry whose courseNumber is >= the given one
+    size_t lowerBound(uint64_t key, string_view courseNumber) const {
+        size_t low = 0;
+        size_t high = entries.size();
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (compareCourseKeys(entries[mid].key, entries[mid].course->courseNumber, key, courseNumber) < 0) low = mid + 1;
+            else high = mid;
+        }
+        return low;
+    }
+
+public:
+    const char* name() const override {
+        return "sorted";
+    }
+
+    void build(const vector<const Course*>& sortedCourses) override {
+        entries.clear();
+        entries.reserve(sortedCourses.size());
+        for (const Course* course : sortedCourses) {
+            entries.push_back({ packCourseKey(course->courseNumber), course });
+        }
+    }
+
+    bool insert(const Course* course) override {
+        uint64_t key = packCourseKey(course->courseNumber);
+        size_t position = lowerBound(key, course->courseNumber);
+        if (position < entries.size() && entries[position].course->courseNumber == string_view(course->courseNumber)) return false;
+        entries.insert(entries.begin() + position, Entry{ key, course });
+        return true;
+    }
+
+    const Course* find(string_view courseNumber) const override {
+        uint64_t key = packCourseKey(courseNumber);
+        size_t position = lowerBound(key, courseNumber);
+        if (position < entries.size() && compareCourseKeys(entries[position].key, entries[position].course->courseNumber,
+            key, courseNumber) == 0) return entries[position].course;
+        return nullptr;
+    }
+
+    size_t size() const override {
+        return entries.size();
+    }
+};
+
+/***************************************************************
+ * FlatHashIndex Class
+ *
+ * Backend "hash": the open-addressing CourseHashIndex that CourseBST already answers its lookups with, on its own.
+ * Expected O(1) lookups and inserts, no ordering.
+ ***************************************************************/
+class FlatHashIndex : public CourseIndex {
+private:
+    CourseHashIndex table;
+
+public:
+    const char* name() const override {
+        return "hash";
+    }
+
+    void build(const vector<const Course*>& sortedCourses) override {
+        table.clear();
+        table.reserve(sortedCourses.size());
+        for (const Course* course : sortedCourses) {
+            insert(course);
+        }
+    }
+
+    bool insert(const Course* course) override {
+        // The table stores mutable pointers for the tree's sake; this backend only ever hands them back as const
+        return table.insert(const_cast<Course*>(course));
+    }
+
+    const Course* find(string_view courseNumber) const override {
+        return table.find(courseNumber);
+    }
+
+    size_t size() const override {
+        return table.size();
+    }
+};
+
+/***************************************************************
+ * AvlIndex Class
+ *
+ * Backend "avl": a height-balanced binary search tree of (packed key, course) nodes, kept in one array and linked by index.
+ * build() makes a perfectly balanced tree from the sorted courses; insert() rebalances on the way back up with the same
+ * AvlBalancer as CourseBST.
+ * O(log n) lookups and inserts, one node (one likely cache miss) per level.
+ ***************************************************************/
+class AvlIndex : public CourseIndex {
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct AvlNode {
+        uint64_t key;
+        const Course* course;
+        uint32_t left;
+        uint32_t right;
+        int height;
+    };
+    vector<AvlNode> nodes;
+    uint32_t root = none;
+
+    // AvlBalancer's view of the array: nodes linked by index, with none for an empty subtree
+    struct IndexLinks {
+        using Ref = uint32_t;
+        vector<AvlNode>* nodes;
+
+        static uint32_t null() {
+            return none;
+        }
+
+        uint32_t& left(uint32_t node) const {
+            return (*nodes)[node].left;
+        }
+
+        uint32_t& right(uint32_t node) const {
+            return (*nodes)[node].right;
+        }
+
+        int& height(uint32_t node) const {
+            return (*nodes)[node].height;
+        }
+    };
+
+    // The same rotations and rebalancing as CourseBST (the returned links refer to nodes, so it is made per use)
+    AvlBalancer<IndexLinks> balancer() {
+        return AvlBalancer<IndexLinks>(IndexLinks{ &nodes });
+    }
+
+    // Inserts below node; returns the subtree's new root and sets added unless the courseNumber was already there
+    uint32_t insertAt(uint32_t node, uint64_t key, const Course* course, bool& added) {
+        if (node == none) {
+            nodes.push_back({ key, course, none, none, 1 });
+            added = true;
+            return static_cast<uint32_t>(nodes.size() - 1);
+        }
+        int order = compareCourseKeys(nodes[node].key, nodes[node].course->courseNumber, key, course->courseNumber);
+        if (order == 0) {
+            added = false;
+            return node;
+        }
+        // nodes may reallocate during the recursive call, so the child link is written afterwards
+        if (order > 0) {
+            uint32_t child = insertAt(nodes[node].left, key, course, added);
+            nodes[node].left = child;
+        }
+        else {
+            uint32_t child = insertAt(nodes[node].right, key, course, added);
+            nodes[node].right = child;
+        }
+        if (added) balancer().rebalance(node);
+        return node;
+    }
+
+    // Builds a balanced subtree from the sorted courses in [low, high); returns its root
+    uint32_t buildRange(const vector<const Course*>& sortedCourses, size_t low, size_t high) {
+        if (low >= high) return none;
+        size_t mid = low + (high - low) / 2;
+        uint32_t node = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({ packCourseKey(sortedCourses[mid]->courseNumber), sortedCourses[mid], none, none, 1 });
+        uint32_t left = buildRange(sortedCourses, low, mid);
+        uint32_t right = buildRange(sortedCourses, mid + 1, high);
+        nodes[node].left = left;
+        nodes[node].right = right;
+        balancer().updateHeight(node);
+        return node;
+    }
+
+public:
+    const char* name() const override {
+        return "avl";
+    }
+
+    void build(const vector<const Course*>& sortedCourses) override {
+        nodes.clear();
+        nodes.reserve(sortedCourses.size());
+        root = buildRange(sortedCourses, 0, sortedCourses.size());
+    }
+
+    bool insert(const Course* course) override {
+        bool added = false;
+        root = insertAt(root, packCourseKey(course->courseNumber), course, added);
+        return added;
+    }
+
+    const Course* find(string_view courseNumber) const override {
+        uint64_t key = packCourseKey(courseNumber);
+        uint32_t node = root;
+        while (node != none) {
+            int order = compareCourseKeys(nodes[node].key, nodes[node].course->courseNumber, key, courseNumber);
+            if (order == 0) return nodes[node].course;
+            node = order > 0 ? nodes[node].left : nodes[node].right;
+        }
+        return nullptr;
+    }
+
+    size_t size() const override {
+        return nodes.size();
+    }
+};
+
+/***************************************************************
+ * BTreeIndex Class
+ *
+ * Backend "btree": a B+ tree of up to 32 entries per node, kept in one array and linked by index. Leaves hold the
+ * (packed key, course) entries in order; an inner node's i-th separator is the smallest entry under its child i + 1.
+ * Each level costs a binary search over one node's contiguous keys instead of a pointer chase per comparison,
+ * so a lookup touches about log32(n) nodes. build() packs full leaves from the sorted courses and adds the inner levels
+ * bottom-up; insert() splits full nodes on the way back up.
+ ***************************************************************/
+class BTreeIndex : public CourseIndex {
+private:
+    static constexpr uint32_t order = 32;
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct BNode {
+        uint32_t count = 0;
+        bool leaf = true;
+        // One spare slot, so a node can overflow by one entry before it is split
+        uint64_t keys[order + 1];
+        const Course* courses[order + 1];
+        uint32_t children[order + 2];
+    };
+    vector<BNode> nodes;
+    uint32_t root = none;
+    size_t entryCount = 0;
+
+    // A node split off during insert: the separator to add to the parent, and the new right-hand node
+    struct Split {
+        uint64_t key;
+        const Course* course;
+        uint32_t right;
+    };
+
+    // Number of entries in node whose courseNumber is <= the given one
+    uint32_t rank(const BNode& node, uint64_t key, string_view courseNumber) const {
+        uint32_t low = 0;
+        uint32_t high = node.count;
+        while (low < high) {
+            uint32_t mid = (low + high) / 2;
+            if (compareCourseKeys(node.keys[mid], node.courses[mid]->courseNumber, key, courseNumber) <= 0) low = mid + 1;
+            else high = mid;
+        }
+        return low;
+    }
+
+    uint32_t newNode(bool leaf) {
+        nodes.emplace_back();
+        nodes.back().leaf = leaf;
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    // Splits an overflowing node in two; the upper half moves to a new node described by the returned Split
+    Split splitNode(uint32_t index) {
+        bool leaf = nodes[index].leaf;
+        uint32_t right = newNode(leaf);
+        BNode& node = nodes[index];
+        BNode& sibling = nodes[right];
+        uint32_t half = node.count / 2;
+        Split split{ node.keys[half], node.courses[half], right };
+        // A leaf keeps its separator as the sibling's first entry; an inner node moves it up to the parent
+        uint32_t first = leaf ? half : half + 1;
+        sibling.count = node.count - first;
+        copy(node.keys + first, node.keys + node.count, sibling.keys);
+        copy(node.courses + first, node.courses + node.count, sibling.courses);
+        if (!leaf) copy(node.children + first, node.children + node.count + 1, sibling.children);
+        node.count = half;
+        return split;
+    }
+
+    // Inserts below the node at index; returns false on a duplicate. Sets split if the node had to be divided.
+    bool insertAt(uint32_t index, uint64_t key, const Course* course, bool& didSplit, Split& split) {
+        uint32_t position = rank(nodes[index], key, course->courseNumber);
+        if (nodes[index].leaf) {
+            if (position > 0 && nodes[index].courses[position - 1]->courseNumber == string_view(course->courseNumber)) return false;
+            insertEntry(nodes[index], position, key, course, none);
+        }
+        else {
+            bool childSplit = false;
+            Split childSeparator;
+            if (!insertAt(nodes[index].children[position], key, course, childSplit, childSeparator)) return false;
+            if (!childSplit) {
+                didSplit = false;
+                return true;
+            }
+            insertEntry(nodes[index], position, childSeparator.key, childSeparator.course, childSeparator.right);
+        }
+        didSplit = nodes[index].count > order;
+        if (didSplit) split = splitNode(index);
+        return true;
+    }
+
+    // Puts an entry at position, and for an inner node the child to its right
+    static void insertEntry(BNode& node, uint32_t position, uint64_t key, const Course* course, uint32_t rightChild) {
+        copy_backward(node.keys + position, node.keys + node.count, node.keys + node.count + 1);
+        copy_backward(node.courses + position, node.courses + node.count, node.courses + node.count + 1);
+        node.keys[position] = key;
+        node.courses[position] = course;
+        if (!node.leaf) {
+            copy_backward(node.children + position + 1, node.children + node.count + 1, node.children + node.count + 2);
+            node.children[position + 1] = rightChild;
+        }
+        ++node.count;
+    }
+
+public:
+    const char* name() const override {
+        return "btree";
+    }
+
+    void build(const vector<const Course*>& sortedCourses) override {
+        nodes.clear();
+        root = none;
+        entryCount = sortedCourses.size();
+        if (sortedCourses.empty()) return;
+
+        // Full leaves first; each level remembers its nodes and the smallest course under each
+        vector<uint32_t> level;
+        vector<const Course*> smallest;
+        for (size_t i = 0; i < sortedCourses.size(); i += order) {
+            uint32_t leaf = newNode(true);
+            BNode& node = nodes[leaf];
+            for (size_t k = i; k < min(sortedCourses.size(), i + order); ++k) {
+                node.keys[node.count] = packCourseKey(sortedCourses[k]->courseNumber);
+                node.courses[node.count] = sortedCourses[k];
+                ++node.count;
+            }
+            level.push_back(leaf);
+            smallest.push_back(sortedCourses[i]);
+        }
+
+        // Then inner levels of up to order + 1 children each, until one node is left
+        while (level.size() > 1) {
+            vector<uint32_t> parents;
+            vector<const Course*> parentSmallest;
+            for (size_t i = 0; i < level.size(); i += order + 1) {
+                uint32_t parent = newNode(false);
+                BNode& node = nodes[parent];
+                node.children[0] = level[i];
+                for (size_t k = i + 1; k < min(level.size(), i + order + 1); ++k) {
+                    node.keys[node.count] = packCourseKey(smallest[k]->courseNumber);
+                    node.courses[node.count] = smallest[k];
+                    node.children[++node.count] = level[k];
+                }
+                parents.push_back(parent);
+                parentSmallest.push_back(smallest[i]);
+            }
+            level.swap(parents);
+            smallest.swap(parentSmallest);
+        }
+        root = level[0];
+    }
+
+    bool insert(const Course* course) override {
+        uint64_t key = packCourseKey(course->courseNumber);
+        if (root == none) {
+            root = newNode(true);
+            insertEntry(nodes[root], 0, key, course, none);
+            entryCount = 1;
+            return true;
+        }
+        bool didSplit = false;
+        Split split;
+        if (!insertAt(root, key, course, didSplit, split)) return false;
+        if (didSplit) {
+            // The root divided: a new root holds the separator between the two halves
+            uint32_t oldRoot = root;
+            root = newNode(false);
+            BNode& node = nodes[root];
+            node.children[0] = oldRoot;
+            node.keys[0] = split.key;
+            node.courses[0] = split.course;
+            node.children[1] = split.right;
+            node.count = 1;
+        }
+        ++entryCount;
+        return true;
+    }
+
+    const Course* find(string_view courseNumber) const override {
+        if (root == none) return nullptr;
+        uint64_t key = packCourseKey(courseNumber);
+        const BNode* node = &nodes[root];
+        while (!node->leaf) {
+            node = &nodes[node->children[rank(*node, key, courseNumber)]];
+        }
+        uint32_t position = rank(*node, key, courseNumber);
+        if (position > 0 && compareCourseKeys(node->keys[position - 1], node->courses[position - 1]->courseNumber,
+            key, courseNumber) == 0) return node->courses[position - 1];
+        return nullptr;
+    }
+
+    size_t size() const override {
+        return entryCount;
+    }
+};
+
+/***************************************************************
+ * ConcurrentCourseIndex Class
+ *
+ * Backend "skiplist": an ordered index that any number of threads may insert into, erase from and search at the same
+ * time, a lock-free skip list behind the CourseIndex insert/find API. Nodes are ordered by packed key first, as in the
+ * tree. It is the only backend whose updates may run while other threads call find(); --stress checks that, and a
+ * server answering through it applies each reload to the live index in place (see QueryCatalog::reloadInPlace).
+ *
+ * A search follows atomic next pointers and never writes or waits. An insert finds the new node's neighbors on every level,
+ * then publishes it with one compare-and-swap on the bottom level (its linearization point: from then on every
+ * search finds it, and an insert of the same courseNumber returns false), and finally links the upper levels, which only
+ * speed up later searches. A failed compare-and-swap means another update got there first, so the neighbors are found again.
+ * An erase marks the low bit of each of the node's next pointers, top level first; marking the bottom one is the erase
+ * (from then on searches skip the node), and a marked pointer can no longer be changed, so nothing is linked after the
+ * node. Every update unlinks the marked nodes it passes, and the erase searches once more so its node is unlinked from
+ * every level. replace() swaps the course a node holds in one atomic exchange.
+ *
+ * Unlinked nodes can't be freed at once, since a concurrent search may still be standing on one: erase() keeps them,
+ * and the caller frees them through takeRetired() once no operation that began before can still be running (the server
+ * waits on its EpochReclaimer). Courses handed back by erase() and replace() are the caller's to retire the same way.
+ * build() and the destructor must not run alongside other calls.
+ ***************************************************************/
+class ConcurrentCourseIndex : public CourseIndex {
+private:
+    // Enough levels for billions of courses at one level in four
+    static constexpr int maxLevel = 16;
+
+    // A node is one allocation: this header, then its levels next pointers. A search reads the key and the next
+    // pointers, which share the node's first cache line, and only reaches the course once it has found it.
+    // The low bit of a next pointer marks the node as erased.
+    struct SkipNode {
+        uint64_t key;
+        // Set before the node is published; replace() may swap it for a course with the same courseNumber
+        atomic<const Course*> course;
+        int levels;
+
+        atomic<SkipNode*>* next() {
+            return reinterpret_cast<atomic<SkipNode*>*>(this + 1);
+        }
+
+        int compareTo(uint64_t otherKey, string_view other) {
+            if (key != otherKey) return key < otherKey ? -1 : 1;
+            return compareCourseKeys(key, course.load(memory_order_acquire)->courseNumber, otherKey, other);
+        }
+    };
+    static_assert(sizeof(SkipNode) % alignof(atomic<SkipNode*>) == 0, "next pointers must be aligned after the node");
+    static_assert(alignof(SkipNode) > 1, "the low bit of a node pointer must be free for the erase mark");
+
+    // The head is a node with maxLevel pointers and no course; it sorts before every key
+    SkipNode* head;
+    atomic<size_t> count;
+    // Nodes erase() has unlinked, waiting for takeRetired
+    mutex retiredLock;
+    vector<SkipNode*> retired;
+
+    static bool isMarked(SkipNode* link) {
+        return (reinterpret_cast<uintptr_t>(link) & 1) != 0;
+    }
+
+    static SkipNode* withMark(SkipNode* link) {
+        return reinterpret_cast<SkipNode*>(reinterpret_cast<uintptr_t>(link) | 1);
+    }
+
+    static SkipNode* withoutMark(SkipNode* link) {
+        return reinterpret_cast<SkipNode*>(reinterpret_cast<uintptr_t>(link) & ~uintptr_t(1));
+    }
+
+    // Allocates a node for course with its next pointers, all starting out null
+    static SkipNode* createNode(const Course* course, int levels) {
+        size_t size = sizeof(SkipNode) + levels * sizeof(atomic<SkipNode*>);
+        SkipNode* node = new (::operator new(size)) SkipNode;
+        node->key = course ? packCourseKey(course->courseNumber) : 0;
+        node->course.store(course, memory_order_relaxed);
+        node->levels = levels;
+        for (int i = 0; i < levels; ++i) {
+            new (&node->next()[i]) atomic<SkipNode*>(nullptr);
+        }
+        return node;
+    }
+
+    // Frees every node after the head, and every retired node
+    void destroyNodes() {
+        SkipNode* node = withoutMark(head->next()[0].load());
+        while (node) {
+            SkipNode* next = withoutMark(node->next()[0].load());
+            ::operator delete(node);
+            node = next;
+        }
+        for (SkipNode* unlinked : retired) ::operator delete(unlinked);
+        retired.clear();
+        for (int level = 0; level < maxLevel; ++level) head->next()[level].store(nullptr);
+        count.store(0);
+    }
+
+    // Level count of a new node: each extra level with probability 1/4, from a per-thread xorshift generator
+    static int randomLevels() {
+        thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ hash<thread::id>{}(this_thread::get_id());
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int levels = 1;
+        for (uint64_t bits = state; levels < maxLevel && (bits & 3) == 0; bits >>= 2) ++levels;
+        return levels;
+    }
+
+    // Fills preds/succs with the last node before the key and the first node at or after it on every level, unlinking
+    // the marked nodes it passes; returns the (unmarked) node holding the key, if any. If unlinking fails because a
+    // predecessor changed meanwhile, the search starts over.
+    SkipNode* findNeighbors(uint64_t key, string_view courseNumber, SkipNode** preds, SkipNode** succs) {
+        for (;;) {
+            bool restart = false;
+            SkipNode* pred = head;
+            for (int level = maxLevel - 1; level >= 0 && !restart; --level) {
+                SkipNode* current = withoutMark(pred->next()[level].load());
+                while (current) {
+                    SkipNode* succ = current->next()[level].load();
+                    if (isMarked(succ)) {
+                        SkipNode* expected = current;
+                        if (!pred->next()[level].compare_exchange_strong(expected, withoutMark(succ))) {
+                            restart = true;
+                            break;
+                        }
+                        current = withoutMark(succ);
+                        continue;
+                    }
+                    if (current->compareTo(key, courseNumber) >= 0) break;
+                    pred = current;
+                    current = succ;
+                }
+                preds[level] = pred;
+                succs[level] = current;
+            }
+            if (restart) continue;
+            SkipNode* found = succs[0];
+            return found && found->compareTo(key, courseNumber) == 0 ? found : nullptr;
+        }
+    }
+
+public:
+    /***************************************************************
+     * RetiredNodes Class
+     *
+     * Nodes erase() unlinked before a takeRetired call. Destroying it frees them, so the caller keeps it until no
+     * search or update that began before the takeRetired call can still be running.
+     ***************************************************************/
+    class RetiredNodes {
+    public:
+        RetiredNodes() = default;
+        RetiredNodes(RetiredNodes&& other) noexcept : nodes(move(other.nodes)) {}
+        RetiredNodes& operator=(RetiredNodes&& other) noexcept {
+            free();
+            nodes = move(other.nodes);
+            return *this;
+        }
+
+        ~RetiredNodes() {
+            free();
+        }
+
+        size_t size() const {
+            return nodes.size();
+        }
+
+    private:
+        friend class ConcurrentCourseIndex;
+        vector<SkipNode*> nodes;
+
+        void free() {
+            for (SkipNode* node : nodes) ::operator delete(node);
+            nodes.clear();
+        }
+    };
+
+    ConcurrentCourseIndex() : head(createNode(nullptr, maxLevel)), count(0) {}
+
+    ConcurrentCourseIndex(const ConcurrentCourseIndex&) = delete;
+    ConcurrentCourseIndex& operator=(const ConcurrentCourseIndex&) = delete;
+
+    ~ConcurrentCourseIndex() override {
+        destroyNodes();
+        ::operator delete(head);
+    }
+
+    const char* name() const override {
+        return "skiplist";
+    }
+
+    void build(const vector<const Course*>& sortedCourses) override {
+        destroyNodes();
+        // In sorted order every course goes after the last one on each level, so the tail of each level is kept
+        // instead of searched for
+        SkipNode* tails[maxLevel];
+        for (int level = 0; level < maxLevel; ++level) tails[level] = head;
+        for (const Course* course : sortedCourses) {
+            SkipNode* node = createNode(course, randomLevels());
+            for (int level = 0; level < node->levels; ++level) {
+                tails[level]->next()[level].store(node, memory_order_relaxed);
+                tails[level] = node;
+            }
+        }
+        count.store(sortedCourses.size(), memory_order_release);
+    }
+
+    // Adds the course; returns false (leaving the index unchanged) if its courseNumber is already present.
+    // Safe to call from any number of threads, alongside find(), erase() and replace().
+    bool insert(const Course* course) override {
+        uint64_t key = packCourseKey(course->courseNumber);
+        string_view courseNumber = course->courseNumber;
+        SkipNode* preds[maxLevel];
+        SkipNode* succs[maxLevel];
+        if (findNeighbors(key, courseNumber, preds, succs)) return false;
+
+        SkipNode* node = createNode(course, randomLevels());
+        for (;;) {
+            node->next()[0].store(succs[0], memory_order_relaxed);
+            // Publishing the node also publishes its course pointer to every thread that later reaches it
+            if (preds[0]->next()[0].compare_exchange_strong(succs[0], node)) break;
+            if (findNeighbors(key, courseNumber, preds, succs)) {
+                // Another thread inserted the same courseNumber first
+                ::operator delete(node);
+                return false;
+            }
+        }
+        count.fetch_add(1, memory_order_relaxed);
+
+        for (int level = 1; level < node->levels; ++level) {
+            bool linked = false;
+            for (;;) {
+                // Point the node at its successor, unless an erase has already marked this level
+                SkipNode* link = node->next()[level].load();
+                if (isMarked(link) || !node->next()[level].compare_exchange_strong(link, succs[level])) break;
+                if (preds[level]->next()[level].compare_exchange_strong(succs[level], node)) {
+                    linked = true;
+                    break;
+                }
+                findNeighbors(key, courseNumber, preds, succs);
+            }
+            if (!linked) break;
+        }
+        // An erase that marked the node while its upper levels were being linked may have missed one of them
+        if (isMarked(node->next()[0].load())) findNeighbors(key, courseNumber, preds, succs);
+        return true;
+    }
+
+    // Removes the course with this courseNumber and returns it (nullptr if there was none). The node is unlinked but
+    // kept until takeRetired, and the course stays the caller's. Safe to call from any number of threads.
+    const Course* erase(string_view courseNumber) {
+        uint64_t key = packCourseKey(courseNumber);
+        SkipNode* preds[maxLevel];
+        SkipNode* succs[maxLevel];
+        SkipNode* node = findNeighbors(key, courseNumber, preds, succs);
+        if (!node) return nullptr;
+
+        // Upper levels first, so no insert links the node on one of them once it is being erased
+        for (int level = node->levels - 1; level >= 1; --level) {
+            SkipNode* link = node->next()[level].load();
+            while (!isMarked(link) && !node->next()[level].compare_exchange_weak(link, withMark(link))) {}
+        }
+        // Marking the bottom level is the erase; if another erase marked it first, this one removed nothing
+        SkipNode* link = node->next()[0].load();
+        for (;;) {
+            if (isMarked(link)) return nullptr;
+            if (node->next()[0].compare_exchange_strong(link, withMark(link))) break;
+        }
+        const Course* removed = node->course.load();
+        count.fetch_sub(1, memory_order_relaxed);
+
+        // Searching again unlinks the node from every level it is on
+        findNeighbors(key, courseNumber, preds, succs);
+        lock_guard<mutex> guard(retiredLock);
+        retired.push_back(node);
+        return removed;
+    }
+
+    // Puts course in place of the one indexed under its courseNumber and returns that one (nullptr, changing nothing,
+    // if the courseNumber isn't indexed). A search returns either course, never neither. Safe alongside every other call.
+    const Course* replace(const Course* course) {
+        SkipNode* preds[maxLevel];
+        SkipNode* succs[maxLevel];
+        SkipNode* node = findNeighbors(packCourseKey(course->courseNumber), course->courseNumber, preds, succs);
+        return node ? node->course.exchange(course) : nullptr;
+    }
+
+    // Hands over the nodes erased so far (see RetiredNodes)
+    RetiredNodes takeRetired() {
+        RetiredNodes taken;
+        lock_guard<mutex> guard(retiredLock);
+        taken.nodes.swap(retired);
+        return taken;
+    }
+
+    // Returns the course if found, otherwise nullptr. Never blocks or writes, even while other threads update the index.
+    const Course* find(string_view courseNumber) const override {
+        uint64_t key = packCourseKey(courseNumber);
+        SkipNode* pred = head;
+        for (int level = maxLevel - 1; level >= 0; --level) {
+            SkipNode* current = withoutMark(pred->next()[level].load(memory_order_acquire));
+            int order = 1;
+            while (current && (order = current->compareTo(key, courseNumber)) < 0) {
+                pred = current;
+                current = withoutMark(pred->next()[level].load(memory_order_acquire));
+            }
+            // A marked node is being erased; the live node with this courseNumber, if any, is found further down
+            if (current && order == 0 && !isMarked(current->next()[0].load(memory_order_acquire))) {
+                return current->course.load(memory_order_acquire);
+            }
+        }
+        return nullptr;
+    }
+
+    // Number of courses in the index
+    size_t size() const override {
+        return count.load(memory_order_relaxed);
+    }
+
+    // Calls visit on every course in sorted order; courses inserted or erased meanwhile may or may not be visited
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        SkipNode* node = withoutMark(head->next()[0].load(memory_order_acquire));
+        while (node) {
+            SkipNode* next = node->next()[0].load(memory_order_acquire);
+            if (!isMarked(next)) visit(*node->course.load(memory_order_acquire));
+            node = withoutMark(next);
+        }
+    }
+};
+
+// Names accepted by --backend, in the order the benchmarks run them
+const char* const courseIndexNames[] = { "sorted", "hash", "avl", "btree", "skiplist" };
+// The other --backend: a FrozenCatalog, which replaces the tree for queries instead of indexing it
+const char* const frozenBackendName = "frozen";
+
+/***************************************************************
+ * makeCourseIndex
+ *
+ * Creates the backend with the given name (see courseIndexNames), or returns nullptr if there is none.
+ ***************************************************************/
+unique_ptr<CourseIndex> makeCourseIndex(string_view name) {
+    if (name == "sorted") return make_unique<SortedVectorIndex>();
+    if (name == "hash") return make_unique<FlatHashIndex>();
+    if (name == "avl") return make_unique<AvlIndex>();
+    if (name == "btree") return make_unique<BTreeIndex>();
+    if (name == "skiplist") return make_unique<ConcurrentCourseIndex>();
+    return nullptr;
+}
+
+/***************************************************************
+ * PrerequisiteGraph Class
+ *
+ * A flat (compressed adjacency array) copy of the resolved prerequisite links, indexed by course id, used to answer
+ * "everything this course needs" queries without touching the tree. Dangling prerequisites have no edge.
+ *
+ * build() also groups the courses into strongly connected components (iterative Tarjan). A component with more than one
+ * course, or a course that lists itself, is a prerequisite cycle. The components form a DAG, and the transitive
+ * prerequisite set is memoized per component: each component's set is computed once, from the sets of the components
+ * it depends on, so sub-chains shared by many courses are never walked twice. Every traversal uses an explicit stack.
+ ***************************************************************/
+class PrerequisiteGraph {
+private:
+    // Marks a course that Tarjan's algorithm hasn't reached yet
+    static constexpr uint32_t unvisited = UINT32_MAX;
+
+    // Outgoing edges of course v are edgeTarget[edgeStart[v] .. edgeStart[v + 1])
+    vector<size_t> edgeStart;
+    vector<uint32_t> edgeTarget;
+
+    // Component of each course; members of component c are componentMembers[componentStart[c] .. componentStart[c + 1])
+    vector<uint32_t> componentOf;
+    vector<size_t> componentStart;
+    vector<uint32_t> componentMembers;
+    // True for components that contain a prerequisite cycle
+    vector<bool> componentCyclic;
+
+    // Memoized transitive prerequisite set of each component (sorted course ids), valid once closureDone is set
+    vector<vector<uint32_t>> closureMemo;
+    vector<bool> closureDone;
+
+    // Scratch marks for de-duplicating ids: a course is marked when mark[v] == markStamp
+    vector<uint32_t> mark;
+    uint32_t markStamp;
+
+    // Starts a fresh round of marks
+    void resetMarks() {
+        if (++markStamp == 0) {
+            fill(mark.begin(), mark.end(), 0);
+            markStamp = 1;
+        }
+    }
+
+    // Groups the courses into strongly connected components. Tarjan's algorithm finishes a component only after every
+    // component reachable from it, so component ids come out with prerequisites numbered before the courses needing them.
+    void findComponents() {
+        size_t n = edgeStart.size() - 1;
+        vector<uint32_t> order(n, unvisited);
+        vector<uint32_t> low(n, 0);
+        vector<bool> onStack(n, false);
+        vector<uint32_t> pending;
+        // Explicit DFS call stack: (course, next edge to follow)
+        vector<pair<uint32_t, size_t>> calls;
+        uint32_t counter = 0;
+
+        componentOf.assign(n, 0);
+        componentStart.assign(1, 0);
+        componentMembers.clear();
+        componentCyclic.clear();
+
+        for (uint32_t startCourse = 0; startCourse < n; ++startCourse) {
+            if (order[startCourse] != unvisited) continue;
+
+            order[startCourse] = low[startCourse] = counter++;
+            pending.push_back(startCourse);
+            onStack[startCourse] = true;
+            calls.emplace_back(startCourse, edgeStart[startCourse]);
+
+            while (!calls.empty()) {
+                uint32_t v = calls.back().first;
+                size_t edge = calls.back().second;
+
+                if (edge < edgeStart[v + 1]) {
+                    // Follow the next edge
+                    calls.back().second = edge + 1;
+                    uint32_t w = edgeTarget[edge];
+                    if (order[w] == unvisited) {
+                        order[w] = low[w] = counter++;
+                        pending.push_back(w);
+                        onStack[w] = true;
+                        calls.emplace_back(w, edgeStart[w]);
+                    }
+                    else if (onStack[w]) {
+                        low[v] = min(low[v], order[w]);
+                    }
+                    continue;
+                }
+
+                // All edges done: pass low up to the caller, and close a component if v is its root
+                calls.pop_back();
+                if (!calls.empty()) {
+                    uint32_t caller = calls.back().first;
+                    low[caller] = min(low[caller], low[v]);
+                }
+                if (low[v] == order[v]) {
+                    uint32_t component = static_cast<uint32_t>(componentStart.size() - 1);
+                    size_t first = componentMembers.size();
+                    uint32_t member;
+                    do {
+                        member = pending.back();
+                        pending.pop_back();
+                        onStack[member] = false;
+                        componentOf[member] = component;
+                        componentMembers.push_back(member);
+                    } while (member != v);
+                    sort(componentMembers.begin() + first, componentMembers.end());
+                    componentStart.push_back(componentMembers.size());
+
+                    // A single course is only cyclic if it lists itself
+                    bool cyclic = componentMembers.size() - first > 1;
+                    for (size_t e = edgeStart[v]; !cyclic && e < edgeStart[v + 1]; ++e) {
+                        cyclic = edgeTarget[e] == v;
+                    }
+                    componentCyclic.push_back(cyclic);
+                }
+            }
+        }
+    }
+
+    // Computes (or returns the memoized) transitive prerequisite set of a component.
+    // Walks the component DAG with an explicit stack so every set it depends on is finished first.
+    const vector<uint32_t>& componentClosure(uint32_t root) {
+        vector<uint32_t> work{ root };
+        while (!work.empty()) {
+            uint32_t c = work.back();
+            if (closureDone[c]) {
+                work.pop_back();
+                continue;
+            }
+
+            // Push any prerequisite component that still needs computing
+            bool ready = true;
+            for (size_t m = componentStart[c]; m < componentStart[c + 1]; ++m) {
+                uint32_t v = componentMembers[m];
+                for (size_t e = edgeStart[v]; e < edgeStart[v + 1]; ++e) {
+                    uint32_t d = componentOf[edgeTarget[e]];
+                    if (d != c && !closureDone[d]) {
+                        work.push_back(d);
+                        ready = false;
+                    }
+                }
+            }
+            if (!ready) continue;
+
+            // Union: the members of every prerequisite component plus their sets (and this component's own members if it is a cycle)
+            resetMarks();
+            vector<uint32_t>& result = closureMemo[c];
+            auto add = [&](uint32_t course) {
+                if (mark[course] != markStamp) {
+                    mark[course] = markStamp;
+                    result.push_back(course);
+                }
+            };
+            if (componentCyclic[c]) {
+                for (size_t m = componentStart[c]; m < componentStart[c + 1]; ++m) add(componentMembers[m]);
+            }
+            for (size_t m = componentStart[c]; m < componentStart[c + 1]; ++m) {
+                uint32_t v = componentMembers[m];
+                for (size_t e = edgeStart[v]; e < edgeStart[v + 1]; ++e) {
+                    uint32_t d = componentOf[edgeTarget[e]];
+                    if (d == c) continue;
+                    for (size_t k = componentStart[d]; k < componentStart[d + 1]; ++k) add(componentMembers[k]);
+                    for (uint32_t course : closureMemo[d]) add(course);
+                }
+            }
+            sort(result.begin(), result.end());
+            closureDone[c] = true;
+            work.pop_back();
+        }
+        return closureMemo[root];
+    }
+
+public:
+    PrerequisiteGraph() : markStamp(0) {}
+
+    // Copies the prerequisite links of a resolved tree (see CourseBST::resolvePrerequisites) into flat arrays,
+    // finds the cycles, and clears any memoized results. O(V + E).
+    void build(const CourseBST& bst) {
+        size_t n = bst.size();
+        edgeStart.assign(1, 0);
+        edgeStart.reserve(n + 1);
+        edgeTarget.clear();
+        for (size_t id = 0; id < n; ++id) {
+            for (const Course* prerequisite : bst.courseAt(id).prerequisiteLinks) {
+                if (prerequisite) edgeTarget.push_back(static_cast<uint32_t>(prerequisite->id));
+            }
+            edgeStart.push_back(edgeTarget.size());
+        }
+
+        findComponents();
+
+        size_t componentCount = componentCyclic.size();
+        closureMemo.assign(componentCount, vector<uint32_t>());
+        closureDone.assign(componentCount, false);
+        mark.assign(n, 0);
+        markStamp = 0;
+    }
+
+    // Number of courses in the graph
+    size_t size() const {
+        return edgeStart.empty() ? 0 : edgeStart.size() - 1;
+    }
+
+    // Direct prerequisites of a course, as [begin, end) over course ids
+    const uint32_t* prerequisitesBegin(uint32_t course) const {
+        return edgeTarget.data() + edgeStart[course];
+    }
+    const uint32_t* prerequisitesEnd(uint32_t course) const {
+        return edgeTarget.data() + edgeStart[course + 1];
+    }
+
+    // Every course the given course needs, directly or indirectly, as sorted course ids.
+    // A course on a prerequisite cycle appears in its own set.
+    const vector<uint32_t>& transitivePrerequisites(uint32_t course) {
+        return componentClosure(componentOf[course]);
+    }
+
+    // True if the course sits on a prerequisite cycle
+    bool onCycle(uint32_t course) const {
+        return componentCyclic[componentOf[course]];
+    }
+
+    // Every prerequisite cycle of two or more courses, as (its smallest course id, the number of courses caught in it),
+    // in increasing id order. A course that only lists itself is left out.
+    vector<pair<uint32_t, size_t>> cyclicGroups() const {
+        vector<pair<uint32_t, size_t>> groups;
+        for (size_t c = 0; c < componentCyclic.size(); ++c) {
+            size_t members = componentStart[c + 1] - componentStart[c];
+            // Members are sorted, so the first is the smallest
+            if (componentCyclic[c] && members > 1) groups.emplace_back(componentMembers[componentStart[c]], members);
+        }
+        sort(groups.begin(), groups.end());
+        return groups;
+    }
+
+    // One concrete cycle through the course (which must be onCycle): course ids starting and ending with course.
+    // Found by a breadth-first search that stays inside the course's component, so it is a shortest such cycle.
+    vector<uint32_t> cycleThrough(uint32_t course) {
+        uint32_t component = componentOf[course];
+        resetMarks();
+        // parent[i] is the course we reached queue[i] from (as a queue position)
+        vector<uint32_t> queue;
+        vector<size_t> parent;
+        for (size_t e = edgeStart[course]; e < edgeStart[course + 1]; ++e) {
+            uint32_t w = edgeTarget[e];
+            if (componentOf[w] == component && mark[w] != markStamp) {
+                mark[w] = markStamp;
+                queue.push_back(w);
+                parent.push_back(SIZE_MAX);
+            }
+        }
+        for (size_t head = 0; head < queue.size(); ++head) {
+            uint32_t v = queue[head];
+            if (v == course) {
+                // Walk back to the first hop, then reverse into course -> ... -> course
+                vector<uint32_t> cycle{ course };
+                for (size_t i = head; i != SIZE_MAX; i = parent[i]) cycle.push_back(queue[i]);
+                reverse(cycle.begin() + 1, cycle.end());
+                return cycle;
+            }
+            for (size_t e = edgeStart[v]; e < edgeStart[v + 1]; ++e) {
+                uint32_t w = edgeTarget[e];
+                if (componentOf[w] == component && mark[w] != markStamp) {
+                    mark[w] = markStamp;
+                    queue.push_back(w);
+                    parent.push_back(head);
+                }
+            }
+        }
+        return {};
+    }
+};
+
+/***************************************************************
+ * SemesterPlan Struct
+ *
+ * The result of SemesterPlanner::plan: the course ids to take in each semester, in order, plus the required
+ * courses that could never be scheduled because they sit on (or behind) a prerequisite cycle.
+ ***************************************************************/
+struct SemesterPlan {
+    vector<vector<uint32_t>> semesters;
+    vector<uint32_t> blocked;
+};
+
+/***************************************************************
+ * SemesterPlanner Class
+ *
+ * Orders a set of target courses, plus everything they require, into semesters with at most perTermLimit courses each.
+ * It is a Kahn-style topological sort over the PrerequisiteGraph, taken one semester at a time: a course becomes
+ * available once all of its prerequisites were taken in earlier semesters, and available courses are taken first come,
+ * first served (ties in course number order). Only the required courses and their edges are touched, so a plan costs
+ * O(V + E) of that subgraph. The scratch arrays live in the planner and are reused, so planning for many students in a row
+ * never re-clears anything sized to the whole catalog.
+ ***************************************************************/
+class SemesterPlanner {
+private:
+    const PrerequisiteGraph& graph;
+
+    // Position of each course in the current plan's required list, valid when stamp[v] == currentStamp
+    vector<uint32_t> localIndex;
+    vector<uint32_t> stamp;
+    uint32_t currentStamp;
+
+    // Starts a new plan: every course counts as unseen again
+    void resetStamps() {
+        if (++currentStamp == 0) {
+            fill(stamp.begin(), stamp.end(), 0);
+            currentStamp = 1;
+        }
+    }
+
+public:
+    explicit SemesterPlanner(const PrerequisiteGraph& g)
+        : graph(g), localIndex(g.size(), 0), stamp(g.size(), 0), currentStamp(0) {}
+
+    // Plans the targets (course ids). perTermLimit == 0 means no limit per semester.
+    SemesterPlan plan(const vector<uint32_t>& targets, size_t perTermLimit) {
+        SemesterPlan result;
+        resetStamps();
+
+        // 1) Collect the targets and everything they require, each once
+        vector<uint32_t> required;
+        auto require = [&](uint32_t course) {
+            if (stamp[course] == currentStamp) return;
+            stamp[course] = currentStamp;
+            localIndex[course] = static_cast<uint32_t>(required.size());
+            required.push_back(course);
+        };
+        for (uint32_t target : targets) require(target);
+        for (size_t next = 0; next < required.size(); ++next) {
+            for (const uint32_t* p = graph.prerequisitesBegin(required[next]); p != graph.prerequisitesEnd(required[next]); ++p) {
+                require(*p);
+            }
+        }
+
+        // 2) Flat reverse edges (prerequisite -> courses that need it) and prerequisite counts, over the required courses only
+        size_t n = required.size();
+        vector<uint32_t> waitingOn(n, 0);
+        vector<size_t> dependentStart(n + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            for (const uint32_t* p = graph.prerequisitesBegin(required[i]); p != graph.prerequisitesEnd(required[i]); ++p) {
+                ++waitingOn[i];
+                ++dependentStart[localIndex[*p] + 1];
+            }
+        }
+        for (size_t i = 0; i < n; ++i) dependentStart[i + 1] += dependentStart[i];
+        vector<uint32_t> dependents(dependentStart[n]);
+        vector<size_t> fillPosition(dependentStart.begin(), dependentStart.end() - 1);
+        for (size_t i = 0; i < n; ++i) {
+            for (const uint32_t* p = graph.prerequisitesBegin(required[i]); p != graph.prerequisitesEnd(required[i]); ++p) {
+                dependents[fillPosition[localIndex[*p]]++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        // 3) Courses with nothing left to wait on, oldest first; the first batch goes in course number order
+        vector<uint32_t> ready;
+        for (size_t i = 0; i < n; ++i) {
+            if (waitingOn[i] == 0) ready.push_back(static_cast<uint32_t>(i));
+        }
+        sort(ready.begin(), ready.end(), [&](uint32_t a, uint32_t b) { return required[a] < required[b]; });
+
+        size_t head = 0;
+        size_t scheduled = 0;
+        vector<uint32_t> unlocked;
+        while (head < ready.size()) {
+            // Fill one semester from the front of the ready queue
+            size_t take = perTermLimit ? min(perTermLimit, ready.size() - head) : ready.size() - head;
+            result.semesters.emplace_back();
+            vector<uint32_t>& semester = result.semesters.back();
+            unlocked.clear();
+            for (size_t k = 0; k < take; ++k) {
+                uint32_t i = ready[head++];
+                semester.push_back(required[i]);
+                // Courses unlocked now can only be taken from next semester on
+                for (size_t d = dependentStart[i]; d < dependentStart[i + 1]; ++d) {
+                    if (--waitingOn[dependents[d]] == 0) unlocked.push_back(dependents[d]);
+                }
+            }
+            scheduled += take;
+            sort(semester.begin(), semester.end());
+            ready.insert(ready.end(), unlocked.begin(), unlocked.end());
+        }
+
+        // 4) Anything never scheduled is stuck behind a cycle
+        if (scheduled < n) {
+            for (size_t i = 0; i < n; ++i) {
+                if (waitingOn[i] > 0) result.blocked.push_back(required[i]);
+            }
+            sort(result.blocked.begin(), result.blocked.end());
+        }
+        return result;
+    }
+};
+
+/***************************************************************
+ * TitleMatch Struct
+ *
+ * One ranked result of a TitleIndex search: the course id, whether the query appears in its text as a substring,
+ * and the fraction of the query's trigrams that the course shares.
+ ***************************************************************/
+struct TitleMatch {
+    uint32_t course;
+    bool substring;
+    double score;
+};
+
+/***************************************************************
+ * TitleIndex Class
+ *
+ * A trigram inverted index over each course's number and title, for substring and typo-tolerant searches.
+ * Text is folded to lower-case letters, digits and single spaces (padded with a space at each end, so word starts and ends
+ * form trigrams too), and every distinct trigram of a course points back to it. The 38-symbol alphabet gives each trigram
+ * a dense code, so the posting lists are built with one counting pass and stored as flat arrays (O(total text) to build).
+ *
+ * A search counts, for each candidate course, how many of the query's trigrams it has. Courses containing the query as a
+ * substring rank first; the rest need at least half of the query's trigrams and rank by that fraction, then by how little
+ * extra text they have. Since a match needs some minimum number of the query's trigrams, only the rarest few of them
+ * can introduce candidates (prefix filtering); the longer posting lists are only probed for courses already found, so
+ * a search never walks the lists of trigrams that nearly every course shares. The counters are scratch arrays reused
+ * across searches, like the SemesterPlanner's.
+ ***************************************************************/
+class TitleIndex {
+private:
+    static constexpr uint32_t alphabetSize = 38;
+    static constexpr uint32_t gramCount = alphabetSize * alphabetSize * alphabetSize;
+
+    // Posting list of trigram g: postings[gramStart[g] .. gramStart[g + 1])
+    vector<uint32_t> gramStart;
+    vector<uint32_t> postings;
+    // Each course's folded text (for the substring check) and its number of distinct trigrams
+    string folded;
+    vector<uint32_t> foldedStart;
+    vector<uint32_t> distinctGrams;
+
+    // Shared-trigram count per course, valid when stamp[course] == currentStamp
+    vector<uint32_t> shared;
+    vector<uint32_t> stamp;
+    uint32_t currentStamp;
+
+    // Set by buildLater: the catalog the next search indexes first (empty once the index is current)
+    size_t pendingCount;
+    function<pair<string_view, string_view>(size_t)> pendingText;
+
+    // Byte tables for folding: what each byte becomes (ASCII letters lower-cased, other ASCII turned into a space,
+    // non-ASCII bytes kept) and the symbol of each folded byte (0 for space, then digits, letters, one for non-ASCII)
+    struct FoldTables {
+        char folded[256];
+        uint8_t symbol[256];
+
+        FoldTables() {
+            for (int byte = 0; byte < 256; ++byte) {
+                bool ascii = byte < 0x80;
+                folded[byte] = !ascii ? static_cast<char>(byte) : isalnum(byte) ? static_cast<char>(tolower(byte)) : ' ';
+                if (byte == ' ') symbol[byte] = 0;
+                else if (byte >= '0' && byte <= '9') symbol[byte] = static_cast<uint8_t>(1 + (byte - '0'));
+                else if (byte >= 'a' && byte <= 'z') symbol[byte] = static_cast<uint8_t>(11 + (byte - 'a'));
+                else symbol[byte] = static_cast<uint8_t>(alphabetSize - 1);
+            }
+        }
+    };
+
+    static const FoldTables& tables() {
+        static const FoldTables instance;
+        return instance;
+    }
+
+    // Appends text folded to the index alphabet, with runs of spaces collapsed to one and none at the ends
+    static void foldInto(string_view text, string& out) {
+        const FoldTables& table = tables();
+        size_t start = out.size();
+        for (char c : text) {
+            char folded = table.folded[static_cast<unsigned char>(c)];
+            if (folded == ' ' && (out.size() == start || out.back() == ' ')) continue;
+            out.push_back(folded);
+        }
+        if (out.size() > start && out.back() == ' ') out.pop_back();
+    }
+
+    // Appends the distinct trigram codes of folded text, with a space added at each end
+    static void gramsOf(string_view text, vector<uint32_t>& grams) {
+        if (text.empty()) return;
+        const FoldTables& table = tables();
+        size_t start = grams.size();
+        uint32_t a = 0;
+        uint32_t b = table.symbol[static_cast<unsigned char>(text[0])];
+        for (size_t i = 1; i <= text.size(); ++i) {
+            uint32_t c = i < text.size() ? table.symbol[static_cast<unsigned char>(text[i])] : 0;
+            grams.push_back((a * alphabetSize + b) * alphabetSize + c);
+            a = b;
+            b = c;
+        }
+        sort(grams.begin() + start, grams.end());
+        grams.erase(unique(grams.begin() + start, grams.end()), grams.end());
+    }
+
+    string_view foldedText(uint32_t course) const {
+        return string_view(folded).substr(foldedStart[course], foldedStart[course + 1] - foldedStart[course]);
+    }
+
+    // Starts a new search: every course's count is zero again
+    void resetStamps() {
+        if (++currentStamp == 0) {
+            fill(stamp.begin(), stamp.end(), 0);
+            currentStamp = 1;
+        }
+    }
+
+public:
+    TitleIndex() : currentStamp(0), pendingCount(0) {}
+
+    // Marks the index out of date and remembers how to rebuild it: the first search afterwards calls build with these
+    // arguments, so a load that never searches titles never pays for the index. courseText must stay valid until then.
+    template <typename CourseText>
+    void buildLater(size_t courseCount, CourseText courseText) {
+        pendingCount = courseCount;
+        pendingText = move(courseText);
+    }
+
+    // Indexes courseCount courses; courseText(id) returns the course's number and title as a pair of string_views
+    template <typename CourseText>
+    void build(size_t courseCount, CourseText courseText) {
+        folded.clear();
+        foldedStart.assign(1, 0);
+        distinctGrams.assign(courseCount, 0);
+        vector<uint32_t> gramCounts(gramCount + 1, 0);
+        // Every course's distinct trigrams, back to back in course order
+        vector<uint32_t> courseGrams;
+
+        // 1) Fold every course's text, collect its trigrams, and count how many courses have each trigram
+        for (size_t id = 0; id < courseCount; ++id) {
+            pair<string_view, string_view> text = courseText(id);
+            size_t start = folded.size();
+            foldInto(text.first, folded);
+            folded.push_back(' ');
+            foldInto(text.second, folded);
+            foldedStart.push_back(static_cast<uint32_t>(folded.size()));
+
+            size_t gramsBefore = courseGrams.size();
+            gramsOf(string_view(folded).substr(start), courseGrams);
+            distinctGrams[id] = static_cast<uint32_t>(courseGrams.size() - gramsBefore);
+            for (size_t i = gramsBefore; i < courseGrams.size(); ++i) ++gramCounts[courseGrams[i] + 1];
+        }
+
+        // 2) Prefix sums give each posting list its slice; fill them in course order, so every list is sorted
+        for (uint32_t g = 0; g < gramCount; ++g) gramCounts[g + 1] += gramCounts[g];
+        postings.assign(gramCounts[gramCount], 0);
+        gramStart = gramCounts;
+        size_t next = 0;
+        for (size_t id = 0; id < courseCount; ++id) {
+            for (uint32_t k = 0; k < distinctGrams[id]; ++k) {
+                postings[gramCounts[courseGrams[next++]]++] = static_cast<uint32_t>(id);
+            }
+        }
+
+        shared.assign(courseCount, 0);
+        stamp.assign(courseCount, 0);
+        currentStamp = 0;
+        pendingText = nullptr;
+    }
+
+    // Number of courses indexed
+    size_t size() const {
+        return distinctGrams.size();
+    }
+
+    // The best matches for query, best first, at most limit of them
+    vector<TitleMatch> search(string_view query, size_t limit) {
+        if (pendingText) {
+            // build clears pendingText, so it runs on a copy
+            auto courseText = pendingText;
+            build(pendingCount, courseText);
+        }
+        vector<TitleMatch> matches;
+        string foldedQuery;
+        foldInto(query, foldedQuery);
+        vector<uint32_t> grams;
+        gramsOf(foldedQuery, grams);
+        if (grams.empty() || size() == 0) return matches;
+
+        // A substring match has every trigram of the query except possibly the two padded ones at its ends;
+        // any other match needs half of them. Either way a match has at least minimumShared of the query's trigrams.
+        uint32_t queryGrams = static_cast<uint32_t>(grams.size());
+        uint32_t innerGrams = queryGrams > 2 ? queryGrams - 2 : 1;
+        uint32_t minimumShared = min(innerGrams, (queryGrams + 1) / 2);
+
+        // Rarest trigrams first. A match has at least one of the first queryGrams - minimumShared + 1 of them,
+        // so only those lists can introduce candidates
+        auto listLength = [this](uint32_t gram) { return gramStart[gram + 1] - gramStart[gram]; };
+        sort(grams.begin(), grams.end(), [&](uint32_t a, uint32_t b) { return listLength(a) < listLength(b); });
+        uint32_t generating = queryGrams - minimumShared + 1;
+
+        resetStamps();
+        vector<uint32_t> candidates;
+        for (uint32_t k = 0; k < queryGrams; ++k) {
+            const uint32_t* first = postings.data() + gramStart[grams[k]];
+            const uint32_t* last = postings.data() + gramStart[grams[k] + 1];
+            if (k < generating) {
+                for (const uint32_t* p = first; p != last; ++p) {
+                    if (stamp[*p] != currentStamp) {
+                        stamp[*p] = currentStamp;
+                        shared[*p] = 0;
+                        candidates.push_back(*p);
+                    }
+                    ++shared[*p];
+                }
+            }
+            else if (candidates.size() * 16 < static_cast<size_t>(last - first)) {
+                // Few candidates against a long list: look each one up (lists are sorted by course)
+                for (uint32_t course : candidates) {
+                    if (binary_search(first, last, course)) ++shared[course];
+                }
+            }
+            else {
+                for (const uint32_t* p = first; p != last; ++p) {
+                    if (stamp[*p] == currentStamp) ++shared[*p];
+                }
+            }
+        }
+
+        for (uint32_t course : candidates) {
+            double score = static_cast<double>(shared[course]) / grams.size();
+            bool substring = shared[course] >= innerGrams && foldedText(course).find(foldedQuery) != string_view::npos;
+            if (substring || score >= 0.5) matches.push_back({ course, substring, score });
+        }
+
+        // Substrings first, then the most query trigrams, then the fewest extra trigrams, then course order
+        auto better = [this](const TitleMatch& a, const TitleMatch& b) {
+            if (a.substring != b.substring) return a.substring;
+            if (a.score != b.score) return a.score > b.score;
+            if (distinctGrams[a.course] != distinctGrams[b.course]) return distinctGrams[a.course] < distinctGrams[b.course];
+            return a.course < b.course;
+        };
+        if (matches.size() > limit) {
+            partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+            matches.resize(limit);
+        }
+        else {
+            sort(matches.begin(), matches.end(), better);
+        }
+        return matches;
+    }
+};
+
+/***************************************************************
+ * Bit scanning helpers
+ *
+ * Index of the lowest / highest set bit of a non-zero mask.
+ ***************************************************************/
+inline unsigned lowestSetBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+inline unsigned highestSetBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(mask));
+#endif
+}
+
+/***************************************************************
+ * ByteBlock Struct
+ *
+ * A thin wrapper over one vector register of bytes (32 with AVX2, 16 with SSE2 or NEON), exposing only what the scanners need:
+ * load/store, byte-wise compare, and a bitmask with bitsPerByte bits for every byte that matched.
+ * x86 gets one bit per byte from movemask; NEON has no movemask, so it narrows the compare result to 4 bits per byte.
+ * When no vector unit is available (or ABCU_SCALAR_ONLY is defined) width is 0 and only the scalar loops run.
+ ***************************************************************/
+struct ByteBlock {
+#if defined(ABCU_SIMD_AVX2)
+    static constexpr size_t width = 32;
+    static constexpr unsigned bitsPerByte = 1;
+    __m256i v;
+
+    static ByteBlock load(const char* p) { return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) }; }
+    static ByteBlock splat(char c) { return { _mm256_set1_epi8(c) }; }
+    void store(char* p) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    ByteBlock operator==(ByteBlock other) const { return { _mm256_cmpeq_epi8(v, other.v) }; }
+    ByteBlock operator|(ByteBlock other) const { return { _mm256_or_si256(v, other.v) }; }
+    ByteBlock operator&(ByteBlock other) const { return { _mm256_and_si256(v, other.v) }; }
+    ByteBlock operator-(ByteBlock other) const { return { _mm256_sub_epi8(v, other.v) }; }
+    // Signed byte compares; ASCII letters are positive, so bytes >= 0x80 never fall inside a letter range
+    ByteBlock operator>(ByteBlock other) const { return { _mm256_cmpgt_epi8(v, other.v) }; }
+    uint64_t bits() const { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+#elif defined(ABCU_SIMD_SSE2)
+    static constexpr size_t width = 16;
+    static constexpr unsigned bitsPerByte = 1;
+    __m128i v;
+
+    static ByteBlock load(const char* p) { return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) }; }
+    static ByteBlock splat(char c) { return { _mm_set1_epi8(c) }; }
+    void store(char* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    ByteBlock operator==(ByteBlock other) const { return { _mm_cmpeq_epi8(v, other.v) }; }
+    ByteBlock operator|(ByteBlock other) const { return { _mm_or_si128(v, other.v) }; }
+    ByteBlock operator&(ByteBlock other) const { return { _mm_and_si128(v, other.v) }; }
+    ByteBlock operator-(ByteBlock other) const { return { _mm_sub_epi8(v, other.v) }; }
+    ByteBlock operator>(ByteBlock other) const { return { _mm_cmpgt_epi8(v, other.v) }; }
+    uint64_t bits() const { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+#elif defined(ABCU_SIMD_NEON)
+    static constexpr size_t width = 16;
+    static constexpr unsigned bitsPerByte = 4;
+    uint8x16_t v;
+
+    static ByteBlock load(const char* p) { return { vld1q_u8(reinterpret_cast<const uint8_t*>(p)) }; }
+    static ByteBlock splat(char c) { return { vdupq_n_u8(static_cast<uint8_t>(c)) }; }
+    void store(char* p) const { vst1q_u8(reinterpret_cast<uint8_t*>(p), v); }
+    ByteBlock operator==(ByteBlock other) const { return { vceqq_u8(v, other.v) }; }
+    ByteBlock operator|(ByteBlock other) const { return { vorrq_u8(v, other.v) }; }
+    ByteBlock operator&(ByteBlock other) const { return { vandq_u8(v, other.v) }; }
+    ByteBlock operator-(ByteBlock other) const { return { vsubq_u8(v, other.v) }; }
+    ByteBlock operator>(ByteBlock other) const {
+        return { vcgtq_s8(vreinterpretq_s8_u8(v), vreinterpretq_s8_u8(other.v)) };
+    }
+    uint64_t bits() const {
+        // Shift-narrow each 16-bit lane by 4, leaving one nibble per byte
+        uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+        return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    }
+#else
+    static constexpr size_t width = 0;
+#endif
+};
+
+/***************************************************************
+ * Byte scanners
+ *
+ * The loader's hot loops: finding the next field delimiter, and trimming / upper-casing course numbers.
+ * Each has a scalar version (always compiled, and used for the last few bytes of a buffer) and a vector version
+ * built on ByteBlock that checks a whole register of bytes per step. Both give byte-identical results.
+ ***************************************************************/
+
+// True for the whitespace toUpperTrim strips
+inline bool isTrimSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// First ',', '\n' or '\r' in [p, end), or end if there is none
+inline const char* findDelimiterScalar(const char* p, const char* end) {
+    while (p < end && *p != ',' && *p != '\n' && *p != '\r') ++p;
+    return p;
+}
+
+inline const char* findDelimiterByte(const char* p, const char* end) {
+#if defined(ABCU_SIMD_AVX2) || defined(ABCU_SIMD_SSE2) || defined(ABCU_SIMD_NEON)
+    const ByteBlock comma = ByteBlock::splat(',');
+    const ByteBlock newline = ByteBlock::splat('\n');
+    const ByteBlock carriage = ByteBlock::splat('\r');
+    while (static_cast<size_t>(end - p) >= ByteBlock::width) {
+        ByteBlock block = ByteBlock::load(p);
+        uint64_t hits = ((block == comma) | (block == newline) | (block == carriage)).bits();
+        if (hits) return p + lowestSetBit(hits) / ByteBlock::bitsPerByte;
+        p += ByteBlock::width;
+    }
+#endif
+    return findDelimiterScalar(p, end);
+}
+
+// Upper-cases ASCII letters in [p, p + n); other bytes are left alone (same as toupper in the "C" locale)
+inline void asciiUpperScalar(char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] >= 'a' && p[i] <= 'z') p[i] = static_cast<char>(p[i] - ('a' - 'A'));
+    }
+}
+
+inline void asciiUpperInPlace(char* p, size_t n) {
+#if defined(ABCU_SIMD_AVX2) || defined(ABCU_SIMD_SSE2) || defined(ABCU_SIMD_NEON)
+    const ByteBlock belowA = ByteBlock::splat('a' - 1);
+    const ByteBlock aboveZ = ByteBlock::splat('z' + 1);
+    const ByteBlock caseBit = ByteBlock::splat('a' - 'A');
+    while (n >= ByteBlock::width) {
+        ByteBlock block = ByteBlock::load(p);
+        // Lowercase letters get 0x20 subtracted; everything else subtracts 0
+        ByteBlock lower = (block > belowA) & (aboveZ > block);
+        (block - (lower & caseBit)).store(p);
+        p += ByteBlock::width;
+        n -= ByteBlock::width;
+    }
+#endif
+    asciiUpperScalar(p, n);
+}
+
+// Bitmask of the whitespace bytes in one block
+#if defined(ABCU_SIMD_AVX2) || defined(ABCU_SIMD_SSE2) || defined(ABCU_SIMD_NEON)
+inline uint64_t trimSpaceBits(ByteBlock block) {
+    return ((block == ByteBlock::splat(' ')) | (block == ByteBlock::splat('\t')) |
+        (block == ByteBlock::splat('\r')) | (block == ByteBlock::splat('\n'))).bits();
+}
+
+// Mask covering every byte of a block, so "all whitespace" can be tested directly
+inline uint64_t fullBlockBits() {
+    return ByteBlock::width * ByteBlock::bitsPerByte == 64 ? ~0ull : (1ull << (ByteBlock::width * ByteBlock::bitsPerByte)) - 1;
+}
+#endif
+
+// First non-whitespace byte in [p, end), or end if it is all whitespace
+inline const char* skipSpaceForward(const char* p, const char* end) {
+#if defined(ABCU_SIMD_AVX2) || defined(ABCU_SIMD_SSE2) || defined(ABCU_SIMD_NEON)
+    while (static_cast<size_t>(end - p) >= ByteBlock::width) {
+        uint64_t content = ~trimSpaceBits(ByteBlock::load(p)) & fullBlockBits();
+        if (content) return p + lowestSetBit(content) / ByteBlock::bitsPerByte;
+        p += ByteBlock::width;
+    }
+#endif
+    while (p < end && isTrimSpace(*p)) ++p;
+    return p;
+}
+
+// One past the last non-whitespace byte in [begin, end), or begin if it is all whitespace
+inline const char* skipSpaceBackward(const char* begin, const char* end) {
+#if defined(ABCU_SIMD_AVX2) || defined(ABCU_SIMD_SSE2) || defined(ABCU_SIMD_NEON)
+    while (static_cast<size_t>(end - begin) >= ByteBlock::width) {
+        uint64_t content = ~trimSpaceBits(ByteBlock::load(end - ByteBlock::width)) & fullBlockBits();
+        if (content) return end - ByteBlock::width + highestSetBit(content) / ByteBlock::bitsPerByte + 1;
+        end -= ByteBlock::width;
+    }
+#endif
+    while (end > begin && isTrimSpace(end[-1])) --end;
+    return end;
+}
+
+/***************************************************************
+ * Utility: toUpperTrimInPlace
+ *
+ * Trims leading/trailing whitespace, then converts the string to uppercase, reusing the string's own buffer.
+ * Ensures consistent matching of course numbers like "csci100" -> "CSCI100".
+ ***************************************************************/
+void toUpperTrimInPlace(string& str) {
+    // Find the real content between the leading and trailing whitespace
+    const char* begin = str.data();
+    const char* first = skipSpaceForward(begin, begin + str.size());
+    const char* last = skipSpaceBackward(first, begin + str.size());
+
+    // Keep only that content, then convert it to uppercase
+    str.erase(static_cast<size_t>(last - begin));
+    str.erase(0, static_cast<size_t>(first - begin));
+    asciiUpperInPlace(&str[0], str.size());
+}
+
+/***************************************************************
+ * Utility: toUpperTrim
+ *
+ * Returns a trimmed, uppercase copy of str (see toUpperTrimInPlace). Used for user input.
+ ***************************************************************/
+string toUpperTrim(const string& str) {
+    string trimmed = str;
+    toUpperTrimInPlace(trimmed);
+    return trimmed;
+}
+
+/***************************************************************
+ * MappedFile Class
+ *
+ * Maps a whole file read-only into memory so the loader can scan it in place, without stream buffers or per-line copies.
+ * Anything that can't be mapped (pipes, devices) is read into an owned buffer instead, so callers always get one contiguous byte range.
+ ***************************************************************/
+class MappedFile {
+private:
+    // Start and length of the file's bytes
+    const char* bytes;
+    size_t length;
+    // True if bytes points at a live mapping that must be unmapped
+    bool mapped;
+    // Holds the contents when the file couldn't be mapped
+    string fallback;
+#ifdef _WIN32
+    // Windows keeps the mapping alive through this handle
+    HANDLE mapping;
+#endif
+
+public:
+    MappedFile() : bytes(nullptr), length(0), mapped(false) {
+#ifdef _WIN32
+        mapping = nullptr;
+#endif
+    }
+
+    // A mapping has exactly one owner
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    // Maps the named file; returns false if it can't be opened
+    bool open(const string& filename) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                if (bytes) {
+                    length = static_cast<size_t>(fileSize.QuadPart);
+                    mapped = true;
+                }
+                else {
+                    CloseHandle(mapping);
+                    mapping = nullptr;
+                }
+            }
+        }
+        CloseHandle(file);
+
+        // Empty or unmappable: read through the C++ stream instead
+        if (!mapped) {
+            ifstream stream(filename, ios::binary);
+            if (!stream.is_open()) return false;
+            fallback.assign(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+            bytes = fallback.data();
+            length = fallback.size();
+        }
+        return true;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                // The loader reads front to back, so let the kernel read ahead aggressively
+                madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                bytes = static_cast<const char*>(view);
+                length = static_cast<size_t>(info.st_size);
+                mapped = true;
+            }
+        }
+
+        // Empty, not a regular file, or mmap failed: read it into the fallback buffer
+        if (!mapped) {
+            char chunk[65536];
+            ssize_t got;
+            while ((got = ::read(fd, chunk, sizeof(chunk))) > 0) {
+                fallback.append(chunk, static_cast<size_t>(got));
+            }
+            bytes = fallback.data();
+            length = fallback.size();
+        }
+        ::close(fd);
+        return true;
+#endif
+    }
+
+    // Releases the mapping (or the fallback buffer)
+    void close() {
+        if (mapped) {
+#ifdef _WIN32
+            UnmapViewOfFile(bytes);
+            CloseHandle(mapping);
+            mapping = nullptr;
+#else
+            munmap(const_cast<char*>(bytes), length);
+#endif
+        }
+        bytes = nullptr;
+        length = 0;
+        mapped = false;
+        fallback.clear();
+    }
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+/***************************************************************
+ * CsvField Struct
+ *
+ * One field of a CSV record, as a view over the original bytes (surrounding quotes removed).
+ ***************************************************************/
+struct CsvField {
+    // The field's bytes, pointing into the scanned buffer
+    string_view text;
+    // True if text still contains doubled "" quotes that need collapsing when the field is copied out
+    bool escapedQuotes;
+
+    // Copies the field into out, collapsing any doubled quotes
+    void assignTo(string& out) const {
+        if (!escapedQuotes) {
+            out.assign(text.data(), text.size());
+            return;
+        }
+        out.clear();
+        for (size_t i = 0; i < text.size(); ++i) {
+            out.push_back(text[i]);
+            // Skip the second quote of each "" pair
+            if (text[i] == '"' && i + 1 < text.size() && text[i + 1] == '"') ++i;
+        }
+    }
+
+    // Interns the field; only a field with doubled quotes is copied (into scratch) first
+    InternedString intern(string& scratch) const {
+        if (!escapedQuotes) return InternedString(text);
+        assignTo(scratch);
+        return InternedString(scratch);
+    }
+};
+
+/***************************************************************
+ * CsvScanner Class
+ *
+ * Splits a byte buffer into CSV records and fields in place. Every record ends at a newline ("\n" or "\r\n"),
+ * matching the original getline-based loader. A field that starts with a double quote runs to the closing quote,
+ * so it may contain commas; "" inside it stands for one quote. As with getline on a stringstream,
+ * a trailing comma does not produce an extra empty field. Blank lines are skipped.
+ * Records are read one field at a time (startRecord, nextField, finishRecord), so CsvSchema can store
+ * each field as soon as it is found instead of collecting the line's fields first.
+ ***************************************************************/
+class CsvScanner {
+private:
+    // Next unread byte, and one past the last byte
+    const char* pos;
+    const char* end;
+    // Start of the record being read, and whether it has fields left
+    const char* recordStart;
+    bool fieldsLeft;
+
+    // True if p sits on the end of a record: end of input, "\n", or "\r\n"
+    bool atRecordEnd(const char* p) const {
+        return p == end || *p == '\n' || (*p == '\r' && (p + 1 == end || p[1] == '\n'));
+    }
+
+    // Returns the first comma or record end at or after p.
+    // A lone '\r' that isn't part of "\r\n" is field content, so scanning continues past it.
+    const char* findDelimiter(const char* p) const {
+        for (;;) {
+            p = findDelimiterByte(p, end);
+            if (p < end && *p == '\r' && !atRecordEnd(p)) {
+                ++p;
+                continue;
+            }
+            return p;
+        }
+    }
+
+    // Scans the quoted field that starts at p (on the opening quote) and returns the position after it.
+    // An unterminated quote runs to the end of the line.
+    const char* scanQuoted(const char* p, CsvField& field) const {
+        const char* textStart = p + 1;
+        const char* q = textStart;
+        for (;;) {
+            while (q < end && *q != '"' && *q != '\n') ++q;
+            // A doubled quote is an escaped quote inside the field
+            if (q + 1 < end && *q == '"' && q[1] == '"') {
+                field.escapedQuotes = true;
+                q += 2;
+                continue;
+            }
+            break;
+        }
+
+        field.text = string_view(textStart, static_cast<size_t>(q - textStart));
+        if (q < end && *q == '"') {
+            // Step over the closing quote
+            ++q;
+        }
+        else if (!field.text.empty() && field.text.back() == '\r') {
+            // Unterminated quote on a "\r\n" line
+            field.text.remove_suffix(1);
+        }
+        return q;
+    }
+
+    // Steps past the line break at pos, if there is one
+    void skipLineBreak() {
+        if (pos < end && *pos == '\r') ++pos;
+        if (pos < end && *pos == '\n') ++pos;
+    }
+
+public:
+    CsvScanner(const char* data, size_t size) : pos(data), end(data + size), recordStart(data), fieldsLeft(false) {}
+
+    // Moves to the start of the next non-blank record, skipping any blank lines (just in case).
+    // Returns false once the input is exhausted.
+    bool startRecord() {
+        while (pos < end && atRecordEnd(pos)) {
+            skipLineBreak();
+        }
+        recordStart = pos;
+        fieldsLeft = pos < end;
+        return fieldsLeft;
+    }
+
+    // Reads the current record's next field into field; returns false once the record has no fields left
+    bool nextField(CsvField& field) {
+        if (!fieldsLeft) return false;
+        const char* p = pos;
+        field = CsvField{ string_view(), false };
+        if (*p == '"') {
+            // Bytes between the closing quote and the next delimiter are ignored
+            p = findDelimiter(scanQuoted(p, field));
+        }
+        else {
+            const char* delimiter = findDelimiter(p);
+            field.text = string_view(p, static_cast<size_t>(delimiter - p));
+            p = delimiter;
+        }
+
+        // Anything but a comma ends the record; a comma right before the end adds no field
+        if (p == end || *p != ',') {
+            fieldsLeft = false;
+        }
+        else {
+            ++p;
+            fieldsLeft = !atRecordEnd(p);
+        }
+        pos = p;
+        return true;
+    }
+
+    // Skips whatever fields the current record has left and steps past its newline.
+    // Returns the whole record (without its newline).
+    string_view finishRecord() {
+        CsvField unused;
+        while (nextField(unused)) {}
+        string_view record(recordStart, static_cast<size_t>(pos - recordStart));
+        skipLineBreak();
+        return record;
+    }
+};
+
+/***************************************************************
+ * LoadMode
+ *
+ * How loadCourses moves parsed courses into the BST:
+ *   - Insert: one insert() (root-to-leaf descent) per CSV line
+ *   - Bulk: gather every course, sort once, then build the tree bottom-up
+ *   - Parallel: like Bulk, but the file is parsed in per-core chunks at the same time
+ *   - Stream: read the file front to back in blocks and insert as it goes, never holding the whole file
+ *     (see streamCourseFile); used for any file that can't be mapped, whatever mode was asked for
+ ***************************************************************/
+enum class LoadMode {
+    Insert,
+    Bulk,
+    Parallel,
+    Stream
+};
+
+/***************************************************************
+ * ParsedChunk Struct
+ *
+ * What one loader thread produced from its chunk of the file: the valid courses in file order,
+ * and the lines it had to skip (as views into the mapped file).
+ ***************************************************************/
+struct ParsedChunk {
+    vector<Course> courses;
+    vector<string_view> invalidLines;
+    // Split and normalize time and lines seen (when metrics are compiled in)
+    LoadProfile profile;
+};
+
+/***************************************************************
+ * hashBytes
+ *
+ * A fast 64-bit hash of a byte range, eight bytes per step. Used to fingerprint CSV rows for reloads, the CSV a snapshot
+ * was built from, and the snapshot itself (it detects accidental change, it is not a cryptographic hash).
+ ***************************************************************/
+uint64_t hashBytes(const char* data, size_t size, uint64_t seed = 0) {
+    const uint64_t multiplier = 0x9fb21c651e98df25ull;
+    uint64_t hash = seed ^ (size * multiplier);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash ^= word * multiplier;
+        hash = ((hash << 29) | (hash >> 35)) * 0xbf58476d1ce4e5b9ull;
+    }
+    if (i < size) {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i);
+        hash ^= word * multiplier;
+        hash = ((hash << 29) | (hash >> 35)) * 0xbf58476d1ce4e5b9ull;
+    }
+    hash ^= hash >> 32;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+/***************************************************************
+ * Course file columns
+ *
+ * Each column type describes one field of a course row: whether a row must have it, whether it repeats to the end of
+ * the row, and how a field is stored into a Course (store). A repeated column also gets start() before its first
+ * field and finish() after its last, so it can gather its values and set its member in one go.
+ * Course numbers (the row's own and its prerequisites') are upper-cased and trimmed; names are kept as written.
+ ***************************************************************/
+struct CourseNumberColumn {
+    static constexpr bool required = true;
+    static constexpr bool repeated = false;
+
+    static void store(const CsvField& field, Course& course, string& scratch) {
+        field.assignTo(scratch);
+        toUpperTrimInPlace(scratch);
+        course.courseNumber = InternedString(scratch);
+    }
+};
+
+struct CourseNameColumn {
+    static constexpr bool required = true;
+    static constexpr bool repeated = false;
+
+    static void store(const CsvField& field, Course& course, string& scratch) {
+        course.courseName = field.intern(scratch);
+    }
+};
+
+struct PrerequisiteColumns {
+    static constexpr bool required = false;
+    static constexpr bool repeated = true;
+
+    // Collects a row's prerequisites so the course's vector is allocated once, at its final size
+    static vector<InternedString>& gathered() {
+        thread_local vector<InternedString> values;
+        return values;
+    }
+
+    static void start(Course&) {
+        gathered().clear();
+    }
+
+    static void store(const CsvField& field, Course&, string& scratch) {
+        field.assignTo(scratch);
+        toUpperTrimInPlace(scratch);
+        gathered().emplace_back(scratch);
+    }
+
+    static void finish(Course& course) {
+        course.prerequisites.assign(gathered().begin(), gathered().end());
+    }
+};
+
+/***************************************************************
+ * CsvSchema Struct
+ *
+ * A row layout as a list of column types, in field order, that generates the parser for it: every row is read
+ * a field at a time from a CsvScanner and each field is stored straight into its Course member, with no vector of fields.
+ * The layout is checked when it is compiled: required columns come first, and only the last column may repeat.
+ * How many fields a valid row needs is worked out from the columns at compile time, and the required fields are
+ * read into a fixed-size array and checked before anything is stored, so an invalid row leaves the Course untouched.
+ * A missing optional column leaves its member as it was; fields beyond the last column are ignored.
+ ***************************************************************/
+// Number of flags that are set, and number of set flags before the first clear one (for CsvSchema's checks)
+constexpr size_t countSet(initializer_list<bool> flags) {
+    size_t count = 0;
+    for (bool flag : flags) count += flag;
+    return count;
+}
+
+constexpr size_t countLeadingSet(initializer_list<bool> flags) {
+    size_t count = 0;
+    for (bool flag : flags) {
+        if (!flag) break;
+        ++count;
+    }
+    return count;
+}
+
+template <typename... Columns>
+struct CsvSchema {
+    static constexpr size_t columnCount = sizeof...(Columns);
+    // Fields every valid row has
+    static constexpr size_t requiredFields = countLeadingSet({ Columns::required... });
+
+    static_assert(columnCount > 0, "a schema needs at least one column");
+    static_assert(countSet({ Columns::required... }) == requiredFields, "required columns must come before optional ones");
+    static_assert(countLeadingSet({ !Columns::repeated... }) + 1 >= columnCount, "only the last column may repeat");
+
+    // The column type of field I
+    template <size_t I>
+    using Column = tuple_element_t<I, tuple<Columns...>>;
+
+private:
+    // Stores column I and every column after it
+    template <size_t I, typename Required>
+    static void storeFrom(const Required& required, CsvScanner& scanner, Course& course, string& scratch) {
+        if constexpr (I < columnCount) {
+            if constexpr (I < requiredFields) {
+                Column<I>::store(required[I], course, scratch);
+            }
+            else if constexpr (Column<I>::repeated) {
+                Column<I>::start(course);
+                CsvField field;
+                while (scanner.nextField(field)) {
+                    Column<I>::store(field, course, scratch);
+                }
+                Column<I>::finish(course);
+            }
+            else {
+                CsvField field;
+                if (scanner.nextField(field)) Column<I>::store(field, course, scratch);
+            }
+            storeFrom<I + 1>(required, scanner, course, scratch);
+        }
+    }
+
+public:
+    // The required fields of one row
+    using RequiredFields = array<CsvField, requiredFields>;
+
+    // Reads the current record's required fields; returns false if the record runs out first (the row is invalid)
+    static bool readRequired(CsvScanner& scanner, RequiredFields& required) {
+        for (CsvField& field : required) {
+            if (!scanner.nextField(field)) return false;
+        }
+        return true;
+    }
+
+    // Stores the required fields read by readRequired, then reads and stores the rest of the record's columns
+    static void store(const RequiredFields& required, CsvScanner& scanner, Course& course, string& scratch) {
+        storeFrom<0>(required, scanner, course, scratch);
+    }
+};
+
+// The course file: [courseNumber, courseName, prereq1, prereq2, ...]
+using CourseCsvSchema = CsvSchema<CourseNumberColumn, CourseNameColumn, PrerequisiteColumns>;
+
+/***************************************************************
+ * parseCourseRecord
+ *
+ * Parses the first record of the CSV bytes in [data, data + size) into course (see CourseCsvSchema) and records
+ * the record's hash, so a later reload can tell whether the row changed. The bytes after the record are left alone,
+ * but its line break is scanned, so a lone '\r' before "\r\n" stays field content as it does in a full load.
+ * Returns false, leaving course untouched, if the record lacks a required field.
+ ***************************************************************/
+bool parseCourseRecord(const char* data, size_t size, Course& course) {
+    // Fields are assembled (quotes collapsed, numbers normalized) in a scratch string before they are interned
+    thread_local string scratch;
+    CsvScanner scanner(data, size);
+    CourseCsvSchema::RequiredFields required;
+    if (!scanner.startRecord() || !CourseCsvSchema::readRequired(scanner, required)) return false;
+    CourseCsvSchema::store(required, scanner, course, scratch);
+    string_view record = scanner.finishRecord();
+    course.rowHash = hashBytes(record.data(), record.size());
+    return true;
+}
+
+/***************************************************************
+ * parseCourseRange
+ *
+ * Scans the CSV bytes in [data, data + size), storing each line's fields straight into a Course as they are found:
+ *    [courseNumber, courseName, prereq1, prereq2]
+ *
+ * Fields are handed over as views into the buffer; the only copies made are the Course's own strings.
+ * Each valid line becomes a Course appended to chunk.courses; lines with fewer than
+ * CourseCsvSchema::requiredFields fields go to chunk.invalidLines.
+ ***************************************************************/
+void parseCourseRange(const char* data, size_t size, ParsedChunk& chunk) {
+    thread_local string scratch;
+    CsvScanner scanner(data, size);
+    CourseCsvSchema::RequiredFields required;
+    // Each clock reading ends one phase and starts the next
+    ABCU_METRIC(uint64_t mark = metricsClock());
+    while (scanner.startRecord()) {
+        bool valid = CourseCsvSchema::readRequired(scanner, required);
+        ABCU_METRIC(uint64_t split = metricsClock(); chunk.profile.splitNanos += split - mark; ++chunk.profile.lines; mark = split);
+        if (!valid) {
+            chunk.invalidLines.push_back(scanner.finishRecord());
+            continue;
+        }
+
+        // Build the Course in place at the end of the list
+        chunk.courses.emplace_back();
+        Course& course = chunk.courses.back();
+        CourseCsvSchema::store(required, scanner, course, scratch);
+        string_view line = scanner.finishRecord();
+        course.rowHash = hashBytes(line.data(), line.size());
+        ABCU_METRIC(mark = metricsClock(); chunk.profile.normalizeNanos += mark - split);
+    }
+    // The scan that found no further line
+    ABCU_METRIC(chunk.profile.splitNanos += metricsClock() - mark);
+}
+
+/***************************************************************
+ * splitAtNewlines
+ *
+ * Cuts [data, data + size) into at most parts pieces of roughly equal size. Every cut is moved forward to just past a newline,
+ * and since a record never spans lines, each piece holds whole records. Returns the parts + 1 boundary offsets.
+ ***************************************************************/
+vector<size_t> splitAtNewlines(const char* data, size_t size, size_t parts) {
+    vector<size_t> bounds{ 0 };
+    for (size_t i = 1; i < parts; ++i) {
+        size_t target = max(bounds.back(), size * i / parts);
+        const void* newline = target < size ? memchr(data + target, '\n', size - target) : nullptr;
+        size_t cut = newline ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : size;
+        // Skip empty pieces (a huge line can swallow several targets)
+        if (cut > bounds.back() && cut < size) bounds.push_back(cut);
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+/***************************************************************
+ * chooseLoadThreads
+ *
+ * One loader thread per hardware thread, but never less than about one megabyte of CSV per thread,
+ * since smaller chunks finish before a thread is worth starting.
+ ***************************************************************/
+size_t chooseLoadThreads(size_t bytes) {
+    const size_t minChunkBytes = 1 << 20;
+    size_t hardwareThreads = max(1u, thread::hardware_concurrency());
+    return max<size_t>(1, min(hardwareThreads, bytes / minChunkBytes));
+}
+
+/***************************************************************
+ * parseCourseFile
+ *
+ * Memory-maps a CSV file (named filename) and parses it (see parseCourseRange), appending the courses to courses in file order.
+ * With threadCount > 1 the file is split at newline boundaries and each chunk is parsed on its own thread;
+ * threadCount 0 picks the count from the mapped file's size (see chooseLoadThreads).
+ * The chunks are stitched back together in file order, and skipped lines are reported in file order afterwards,
+ * so the result, the warnings and the order of duplicate courses are the same for any thread count.
+ * If profile is given, the read, split and normalize time, the lines seen and the invalid lines are added to it.
+ * Returns false (after printing an error) if the file can't be opened.
+ ***************************************************************/
+bool parseCourseFile(const string& filename, vector<Course>& courses, size_t threadCount = 1, bool printWarnings = true,
+    LoadProfile* profile = nullptr) {
+    MappedFile file;
+    ABCU_METRIC(uint64_t readStart = metricsClock());
+    if (!file.open(filename)) {
+        // If file isn't found or can't be opened, print an error
+        cout << "ERROR: Could not open file: " << filename << endl;
+        return false;
+    }
+    ABCU_METRIC(if (profile) profile->readNanos += metricsClock() - readStart);
+
+    // Parse every chunk at the same time
+    if (threadCount == 0) threadCount = chooseLoadThreads(file.size());
+    vector<size_t> bounds = splitAtNewlines(file.data(), file.size(), threadCount);
+    vector<ParsedChunk> chunks(bounds.size() - 1);
+    runInParallel(chunks.size(), [&](size_t i) {
+        parseCourseRange(file.data() + bounds[i], bounds[i + 1] - bounds[i], chunks[i]);
+    });
+    if (profile) {
+        for (const auto& chunk : chunks) {
+            profile->addParse(chunk.profile);
+            profile->invalidLines += chunk.invalidLines.size();
+        }
+    }
+
+    // Report skipped lines in file order, the same as a single pass would
+    if (printWarnings) {
+        for (const auto& chunk : chunks) {
+            for (const auto& line : chunk.invalidLines) {
+                cout << "WARNING: Invalid course line (skipped): " << line << endl;
+            }
+        }
+    }
+
+    // Work out where each chunk lands in the output, then move the chunks into place concurrently
+    vector<size_t> offsets{ courses.size() };
+    for (const auto& chunk : chunks) {
+        offsets.push_back(offsets.back() + chunk.courses.size());
+    }
+    courses.resize(offsets.back());
+    runInParallel(chunks.size(), [&](size_t i) {
+        move(chunks[i].courses.begin(), chunks[i].courses.end(), courses.begin() + offsets[i]);
+    });
+
+    return true;
+}
+
+/***************************************************************
+ * isStreamSource
+ *
+ * True if filename names a feed that has to be read front to back rather than mapped: "-" (standard input),
+ * a gzip-compressed file (".gz"), or anything that isn't a regular file, such as a pipe.
+ ***************************************************************/
+bool isStreamSource(const string& filename) {
+    if (filename == "-") return true;
+    if (filename.size() >= 3 && filename.compare(filename.size() - 3, 3, ".gz") == 0) return true;
+    error_code problem;
+    filesystem::file_status status = filesystem::status(filename, problem);
+    return !problem && filesystem::exists(status) && !filesystem::is_regular_file(status);
+}
+
+/***************************************************************
+ * isRereadableSource
+ *
+ * True if filename can be read again from the start, as every server reload does: a regular file (compressed or not).
+ * Standard input and pipes are used up by the first load. A file that doesn't exist counts, so loading it reports why.
+ ***************************************************************/
+bool isRereadableSource(const string& filename) {
+    if (filename == "-") return false;
+    error_code problem;
+    filesystem::file_status status = filesystem::status(filename, problem);
+    return problem || !filesystem::exists(status) || filesystem::is_regular_file(status);
+}
+
+/***************************************************************
+ * FeedReader Class
+ *
+ * Reads a catalog feed in blocks: standard input ("-"), a gzip file (decompressed by "gzip -dc" through a pipe),
+ * or any other file or pipe through an ifstream. Only the block the caller passes in is ever held.
+ * gzip files need a POSIX shell to quote the name for, so they aren't supported on Windows.
+ ***************************************************************/
+class FeedReader {
+public:
+    FeedReader() : input(nullptr), decompressor(nullptr) {}
+
+    FeedReader(const FeedReader&) = delete;
+    FeedReader& operator=(const FeedReader&) = delete;
+
+    ~FeedReader() {
+        close();
+    }
+
+    // Starts reading filename; returns false if it can't be opened
+    bool open(const string& filename) {
+        if (filename == "-") {
+            input = &cin;
+            return true;
+        }
+        if (filename.size() >= 3 && filename.compare(filename.size() - 3, 3, ".gz") == 0) {
+#ifdef _WIN32
+            cout << "ERROR: Compressed (.gz) catalogs can't be read on Windows; decompress " << filename << " first" << endl;
+            return false;
+#else
+            if (!ifstream(filename)) return false;
+            // Single-quote the name for the shell (a quote inside it becomes '\'')
+            string command = "gzip -dc -- '";
+            for (char c : filename) {
+                if (c == '\'') command += "'\\''";
+                else command += c;
+            }
+            command += "'";
+            decompressor = popen(command.c_str(), "r");
+            return decompressor != nullptr;
+#endif
+        }
+        file.open(filename, ios::binary);
+        if (!file) return false;
+        input = &file;
+        return true;
+    }
+
+    // Reads up to size bytes into buffer; returns 0 once the feed is exhausted
+    size_t read(char* buffer, size_t size) {
+        if (decompressor) return fread(buffer, 1, size, decompressor);
+        if (!input) return 0;
+        input->read(buffer, static_cast<streamsize>(size));
+        return static_cast<size_t>(input->gcount());
+    }
+
+    // Finishes the feed; returns false if the decompressor reported an error
+    bool close() {
+        bool ok = true;
+#ifndef _WIN32
+        if (decompressor) {
+            ok = pclose(decompressor) == 0;
+            decompressor = nullptr;
+        }
+#endif
+        if (file.is_open()) file.close();
+        input = nullptr;
+        return ok;
+    }
+
+private:
+    ifstream file;
+    istream* input;
+    FILE* decompressor;
+};
+
+/***************************************************************
+ * BoundedQueue Class
+ *
+ * A blocking first-in, first-out queue holding at most capacity items, linking one producer thread to one consumer:
+ * push() waits while the queue is full, so a fast producer can't run ahead of the consumer by more than capacity items.
+ * After close(), pop() drains what is left and then returns false.
+ ***************************************************************/
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    void push(T item) {
+        unique_lock<mutex> guard(lock);
+        notFull.wait(guard, [this] { return items.size() < capacity; });
+        items.push_back(move(item));
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& item) {
+        unique_lock<mutex> guard(lock);
+        notEmpty.wait(guard, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    deque<T> items;
+    mutex lock;
+    condition_variable notFull;
+    condition_variable notEmpty;
+};
+
+/***************************************************************
+ * StreamBatch Struct
+ *
+ * The courses parsed from one block of a streamed feed, and the lines it skipped (copied, since the block is reused).
+ ***************************************************************/
+struct StreamBatch {
+    vector<Course> courses;
+    vector<string> invalidLines;
+};
+
+/***************************************************************
+ * streamCourseFile
+ *
+ * Loads a feed that can't be mapped (see isStreamSource) without ever holding all of it: a reader thread pulls
+ * fixed-size blocks from the FeedReader, parses the complete lines in each (see parseCourseRange) and passes them on
+ * as a StreamBatch through a BoundedQueue, while this thread inserts each batch into the BST. A line cut off by the end
+ * of a block is carried to the front of the next one; the buffer only grows past a block for a line longer than that.
+ * So besides the tree itself the loader holds at most a few blocks' worth of bytes and parsed courses, however long the feed.
+ * Invalid lines are reported in feed order; courseNumbers seen again are added to duplicates and skipped.
+ * courseCount is increased by the number of valid rows read, duplicates included. If profile is given, the read, split,
+ * normalize and insert time, the lines seen and the invalid lines are added to it.
+ * Returns false if the feed can't be opened or the decompressor fails (the courses streamed so far stay in the tree).
+ ***************************************************************/
+bool streamCourseFile(const string& filename, CourseBST& bst, vector<string>& duplicates, size_t& courseCount,
+    LoadProfile* profile = nullptr) {
+    const size_t blockSize = 1 << 20;
+    const size_t queuedBatches = 4;
+
+    FeedReader feed;
+    if (!feed.open(filename)) {
+        cout << "ERROR: Could not open file: " << filename << endl;
+        return false;
+    }
+
+    BoundedQueue<StreamBatch> batches(queuedBatches);
+    // Filled by the reader thread only, and added to profile once it has finished
+    LoadProfile readerProfile;
+    thread reader([&] {
+        vector<char> buffer;
+        size_t carried = 0;
+        for (;;) {
+            buffer.resize(carried + blockSize);
+            ABCU_METRIC(uint64_t readStart = metricsClock());
+            size_t got = feed.read(buffer.data() + carried, blockSize);
+            ABCU_METRIC(readerProfile.readNanos += metricsClock() - readStart);
+            size_t filled = carried + got;
+            bool finished = got == 0;
+
+            // Parse up to the last newline; the rest of the line waits for the next block
+            size_t usable = filled;
+            if (!finished) {
+                const char* data = buffer.data();
+                size_t lastNewline = filled;
+                while (lastNewline > carried && data[lastNewline - 1] != '\n') --lastNewline;
+                if (lastNewline == carried) {
+                    // No newline in the new bytes (nor in the carried ones): the line goes on, so read more before parsing
+                    carried = filled;
+                    continue;
+                }
+                usable = lastNewline;
+            }
+
+            if (usable > 0) {
+                ParsedChunk chunk;
+                parseCourseRange(buffer.data(), usable, chunk);
+                readerProfile.addParse(chunk.profile);
+                StreamBatch batch;
+                batch.courses = move(chunk.courses);
+                for (string_view line : chunk.invalidLines) batch.invalidLines.emplace_back(line);
+                batches.push(move(batch));
+            }
+            if (finished) break;
+
+            carried = filled - usable;
+            memmove(buffer.data(), buffer.data() + usable, carried);
+            // Give back the room a very long line needed once it has been parsed
+            if (buffer.capacity() > 4 * blockSize && carried < blockSize) buffer.shrink_to_fit();
+        }
+        batches.close();
+    });
+
+    StreamBatch batch;
+    while (batches.pop(batch)) {
+        for (const string& line : batch.invalidLines) {
+            cout << "WARNING: Invalid course line (skipped): " << line << endl;
+        }
+        if (profile) profile->invalidLines += batch.invalidLines.size();
+        courseCount += batch.courses.size();
+        ABCU_METRIC(uint64_t insertStart = metricsClock());
+        for (auto& course : batch.courses) {
+            if (!bst.insert(move(course))) duplicates.push_back(string(course.courseNumber));
+        }
+        ABCU_METRIC(if (profile) profile->insertNanos += metricsClock() - insertStart);
+    }
+    reader.join();
+    if (profile) profile->addParse(readerProfile);
+
+    if (!feed.close()) {
+        cout << "ERROR: Could not decompress file: " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+/***************************************************************
+ * reportDangling
+ *
+ * Shows the first few prerequisites that name courses missing from the catalog.
+ ***************************************************************/
+void reportDangling(const vector<DanglingPrerequisite>& dangling) {
+    if (dangling.empty()) return;
+
+    const size_t maxShown = 10;
+    cout << "WARNING: " << dangling.size() << " prerequisite(s) name courses that are not in the catalog:" << endl;
+    for (size_t i = 0; i < dangling.size() && i < maxShown; ++i) {
+        const Course* course = dangling[i].course;
+        cout << "  " << course->courseNumber << " requires " << course->prerequisites[dangling[i].index] << endl;
+    }
+    if (dangling.size() > maxShown) {
+        cout << "  ... and " << dangling.size() - maxShown << " more" << endl;
+    }
+}
+
+/***************************************************************
+ * CatalogReport Struct
+ *
+ * What validating a catalog found. The load fills in the rows it skipped: lines with too few fields, and courseNumbers
+ * seen again (only the first row is kept). validateCatalog fills in what is wrong with the catalog itself: courses that
+ * list themselves as a prerequisite, prerequisites that name a course not in the catalog, and prerequisite cycles of
+ * two or more courses, each shown as one shortest cycle through its smallest course.
+ * Skipped rows are in file order and everything else in course id order, whatever the number of threads.
+ * The course pointers point into the validated tree, so the report is only good until that tree changes.
+ ***************************************************************/
+struct CatalogReport {
+    // One prerequisite cycle: the courses around it (first and last are the same course), and how many courses
+    // depend on each other through it (its strongly connected component, which may hold more than the path)
+    struct Cycle {
+        vector<const Course*> path;
+        size_t courses = 0;
+    };
+
+    // Rows the load skipped
+    size_t invalidLines = 0;
+    vector<string> duplicateCourses;
+    // Problems found by the sweep
+    vector<const Course*> selfReferences;
+    vector<DanglingPrerequisite> dangling;
+    vector<Cycle> cycles;
+    // Courses checked, how long the sweep took and how many threads ran it
+    size_t courses = 0;
+    uint64_t validateNanos = 0;
+    size_t threads = 0;
+
+    // Number of problems of every kind together
+    size_t problems() const {
+        return invalidLines + duplicateCourses.size() + selfReferences.size() + dangling.size() + cycles.size();
+    }
+
+    // True if nothing is wrong, so the catalog can be published
+    bool clean() const {
+        return problems() == 0;
+    }
+};
+
+/***************************************************************
+ * validateCatalog
+ *
+ * Checks every course of a resolved tree (see CourseBST::resolvePrerequisites) for self-referencing and dangling
+ * prerequisites, and finds the prerequisite cycles, recording them in report (the skipped-row counts are left alone).
+ * The courses are swept in slices by id, one thread per slice, while one more thread builds a PrerequisiteGraph
+ * to find the cycles; each thread keeps its own findings, which are joined in id order at the end. O(V + E).
+ ***************************************************************/
+void validateCatalog(const CourseBST& bst, CatalogReport& report) {
+    auto start = chrono::steady_clock::now();
+    size_t courseCount = bst.size();
+    size_t sliceCount = sliceCountFor(courseCount);
+
+    struct SliceFindings {
+        vector<const Course*> selfReferences;
+        vector<DanglingPrerequisite> dangling;
+    };
+    vector<SliceFindings> slices(sliceCount);
+    vector<CatalogReport::Cycle> cycles;
+
+    // Task 0 finds the cycles; task i sweeps slice i - 1
+    runInParallel(sliceCount + 1, [&](size_t task) {
+        if (task == 0) {
+            PrerequisiteGraph graph;
+            graph.build(bst);
+            for (const auto& group : graph.cyclicGroups()) {
+                CatalogReport::Cycle cycle;
+                for (uint32_t id : graph.cycleThrough(group.first)) cycle.path.push_back(&bst.courseAt(id));
+                cycle.courses = group.second;
+                cycles.push_back(move(cycle));
+            }
+            return;
+        }
+
+        SliceFindings& findings = slices[task - 1];
+        size_t first = courseCount * (task - 1) / sliceCount;
+        size_t last = courseCount * task / sliceCount;
+        for (size_t id = first; id < last; ++id) {
+            const Course& course = bst.courseAt(id);
+            bool listsItself = false;
+            for (size_t i = 0; i < course.prerequisiteLinks.size(); ++i) {
+                const Course* prerequisite = course.prerequisiteLinks[i];
+                if (!prerequisite) {
+                    findings.dangling.push_back({ &course, i });
+                }
+                else if (prerequisite == &course) {
+                    listsItself = true;
+                }
+            }
+            if (listsItself) findings.selfReferences.push_back(&course);
+        }
+    });
+
+    report.selfReferences.clear();
+    report.dangling.clear();
+    for (const auto& findings : slices) {
+        report.selfReferences.insert(report.selfReferences.end(), findings.selfReferences.begin(), findings.selfReferences.end());
+        report.dangling.insert(report.dangling.end(), findings.dangling.begin(), findings.dangling.end());
+    }
+    report.cycles = move(cycles);
+    report.courses = courseCount;
+    report.threads = sliceCount + 1;
+    report.validateNanos = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+/***************************************************************
+ * printCatalogReport
+ *
+ * Shows a validation report: a summary line, then the count of each kind of problem found with its first few cases.
+ ***************************************************************/
+void printCatalogReport(const CatalogReport& report) {
+    const size_t maxShown = 10;
+
+    cout << "Validated " << report.courses << " courses in " << report.validateNanos / 1e6 << " ms on "
+        << report.threads << " threads: ";
+    if (report.clean()) {
+        cout << "no problems found." << endl;
+        return;
+    }
+    cout << report.problems() << " problem(s) found." << endl;
+
+    // Prints the heading and the first few cases of one kind of problem; show(i) prints case i
+    auto list = [&](size_t count, const char* heading, auto show) {
+        if (count == 0) return;
+        cout << "  " << count << ' ' << heading << endl;
+        for (size_t i = 0; i < count && i < maxShown; ++i) {
+            cout << "    ";
+            show(i);
+            cout << endl;
+        }
+        if (count > maxShown) {
+            cout << "    ... and " << count - maxShown << " more" << endl;
+        }
+    };
+
+    if (report.invalidLines) {
+        cout << "  " << report.invalidLines << " invalid line(s) with fewer than " << CourseCsvSchema::requiredFields
+            << " fields (skipped)" << endl;
+    }
+    list(report.duplicateCourses.size(), "duplicate course(s) (later rows skipped):", [&](size_t i) {
+        cout << report.duplicateCourses[i];
+    });
+    list(report.selfReferences.size(), "course(s) listing themselves as a prerequisite:", [&](size_t i) {
+        cout << report.selfReferences[i]->courseNumber;
+    });
+    list(report.dangling.size(), "prerequisite(s) naming courses that are not in the catalog:", [&](size_t i) {
+        const Course* course = report.dangling[i].course;
+        cout << course->courseNumber << " requires " << course->prerequisites[report.dangling[i].index];
+    });
+    list(report.cycles.size(), "prerequisite cycle(s):", [&](size_t i) {
+        const CatalogReport::Cycle& cycle = report.cycles[i];
+        for (size_t k = 0; k < cycle.path.size(); ++k) {
+            cout << (k ? " -> " : "") << cycle.path[k]->courseNumber;
+        }
+        if (cycle.courses > cycle.path.size() - 1) {
+            cout << " (" << cycle.courses << " courses caught in it)";
+        }
+    });
+}
+
+/***************************************************************
+ * loadCourses
+ *
+ * Parses the CSV file (see parseCourseFile), then moves the courses into the BST and resolves their prerequisites.
+ * By default the file is parsed on several threads and the tree is built bottom-up from one sort (LoadMode::Parallel);
+ * LoadMode::Bulk does the same on one thread, and LoadMode::Insert keeps the original one-insert-per-line behavior.
+ * A successful load publishes its LoadProfile to metrics. Given report, it also records the rows it skipped there
+ * and validates the loaded catalog (see validateCatalog).
+ * If the file can't be opened, an error is displayed and false is returned.
+ ***************************************************************/
+bool loadCourses(const string& filename, CourseBST& bst, LoadMode mode = LoadMode::Parallel, CatalogReport* report = nullptr) {
+    cout << "Loading courses from " << filename << "..." << endl;
+    LoadProfile profile;
+    ABCU_METRIC(uint64_t loadStart = metricsClock());
+
+    // Count heap allocations made by parsing and building
+    ABCU_METRIC(size_t allocationsBefore = heapAllocations());
+
+    // A courseNumber seen again keeps its first row
+    vector<string> duplicates;
+    size_t courseCount = 0;
+    if (mode == LoadMode::Stream || isStreamSource(filename)) {
+        // Pipes, standard input and compressed feeds are inserted block by block as they arrive
+        if (!streamCourseFile(filename, bst, duplicates, courseCount, &profile)) {
+            return false;
+        }
+    }
+    else {
+        // Only the parallel mode splits the file; 0 lets parseCourseFile choose from the size it maps
+        size_t threadCount = mode == LoadMode::Parallel ? 0 : 1;
+        vector<Course> courses;
+        if (!parseCourseFile(filename, courses, threadCount, true, &profile)) {
+            return false;
+        }
+        courseCount = courses.size();
+        ABCU_METRIC(uint64_t insertStart = metricsClock());
+        if (mode == LoadMode::Insert) {
+            // Insert the courses into the BST one at a time, moving each one into its node
+            for (auto& course : courses) {
+                if (!bst.insert(move(course))) duplicates.push_back(string(course.courseNumber));
+            }
+        }
+        else {
+            // Sort once and build a perfectly balanced tree
+            bst.bulkLoad(move(courses), &duplicates);
+        }
+        ABCU_METRIC(profile.insertNanos += metricsClock() - insertStart);
+    }
+    for (const auto& courseNumber : duplicates) {
+        cout << "WARNING: Duplicate course (skipped): " << courseNumber << endl;
+    }
+    courseCount -= duplicates.size();
+
+    // Link prerequisites to their courses once, so queries never have to search for them
+    ABCU_METRIC(uint64_t resolveStart = metricsClock());
+    const vector<DanglingPrerequisite>& dangling = bst.resolvePrerequisites();
+    ABCU_METRIC(profile.resolveNanos = metricsClock() - resolveStart);
+
+    cout << "Courses loaded into data structure." << endl;
+    ABCU_METRIC(
+        size_t allocations = heapAllocations() - allocationsBefore;
+        cout << "Loaded " << courseCount << " courses with " << allocations << " heap allocations ("
+            << (courseCount ? static_cast<double>(allocations) / courseCount : 0.0) << " per course)." << endl);
+
+    reportDangling(dangling);
+
+    ABCU_METRIC(
+        profile.totalNanos = metricsClock() - loadStart;
+        profile.courses = courseCount;
+        profile.duplicates = duplicates.size();
+        profile.danglingPrerequisites = dangling.size();
+        metrics.publishLoad(profile));
+
+    if (report) {
+        report->invalidLines = profile.invalidLines;
+        report->duplicateCourses = move(duplicates);
+        validateCatalog(bst, *report);
+    }
+    return true;
+}
+
+/***************************************************************
+ * reloadCourses
+ *
+ * Brings a tree that was loaded from filename up to date with the file's current contents, touching only what changed.
+ * Every row is hashed and its courseNumber looked up: a row whose hash matches the loaded course is left alone,
+ * a changed row updates that course in place, a new courseNumber is inserted, and a loaded course whose row is gone is erased.
+ * Only changed rows are parsed into Courses, and the tree work is proportional to the number of changes
+ * (the file itself is still read once, and the prerequisite links are re-resolved afterwards).
+ * Duplicate rows keep their first occurrence, as in a full load. Returns false if the file can't be opened.
+ ***************************************************************/
+bool reloadCourses(const string& filename, CourseBST& bst) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cout << "ERROR: Could not open file: " << filename << endl;
+        return false;
+    }
+
+    cout << "Reloading courses from " << filename << "..." << endl;
+
+    // Course ids index the seen flags below
+    if (!bst.prerequisitesResolved()) bst.resolvePrerequisites();
+    vector<bool> seen(bst.size(), false);
+
+    size_t unchanged = 0;
+    size_t updated = 0;
+    vector<Course> added;
+    unordered_set<string> addedKeys;
+
+    // Only the course number is needed to tell whether a row changed; changed rows are then parsed in full
+    static_assert(is_same_v<CourseCsvSchema::Column<0>, CourseNumberColumn>, "reloads look rows up by their first field");
+    CsvScanner scanner(file.data(), file.size());
+    const char* fileEnd = file.data() + file.size();
+    CourseCsvSchema::RequiredFields required;
+    string courseKey;
+    while (scanner.startRecord()) {
+        bool valid = CourseCsvSchema::readRequired(scanner, required);
+        string_view line = scanner.finishRecord();
+        if (!valid) {
+            cout << "WARNING: Invalid course line (skipped): " << line << endl;
+            continue;
+        }
+        required[0].assignTo(courseKey);
+        toUpperTrimInPlace(courseKey);
+
+        Course* existing = bst.search(courseKey);
+        if (existing) {
+            if (seen[existing->id]) {
+                cout << "WARNING: Duplicate course (skipped): " << courseKey << endl;
+                continue;
+            }
+            seen[existing->id] = true;
+
+            // Same bytes as last time => nothing to do
+            if (existing->rowHash == hashBytes(line.data(), line.size())) {
+                ++unchanged;
+                continue;
+            }
+            parseCourseRecord(line.data(), static_cast<size_t>(fileEnd - line.data()), *existing);
+            ++updated;
+        }
+        else {
+            if (!addedKeys.insert(courseKey).second) {
+                cout << "WARNING: Duplicate course (skipped): " << courseKey << endl;
+                continue;
+            }
+            added.emplace_back();
+            parseCourseRecord(line.data(), static_cast<size_t>(fileEnd - line.data()), added.back());
+        }
+    }
+
+    // Loaded courses whose row disappeared
+    vector<string> removed;
+    for (size_t id = 0; id < seen.size(); ++id) {
+        if (!seen[id]) removed.push_back(string(bst.courseAt(id).courseNumber));
+    }
+    for (const auto& courseNumber : removed) {
+        bst.erase(courseNumber);
+    }
+    for (auto& course : added) {
+        bst.insert(move(course));
+    }
+
+    const vector<DanglingPrerequisite>& dangling = bst.resolvePrerequisites();
+    cout << "Courses reloaded: " << added.size() << " added, " << updated << " updated, "
+        << removed.size() << " removed, " << unchanged << " unchanged." << endl;
+    reportDangling(dangling);
+    return true;
+}
+
+/***************************************************************
+ * validateCatalogFile
+ *
+ * Parses filename into a scratch tree the way loadCourses does, without printing the load's warnings, then validates
+ * it (see validateCatalog) and prints the report. The file itself is checked, whether the menu's copy of the catalog
+ * came from a snapshot or was patched by reloads. Returns false if the file can't be opened.
+ ***************************************************************/
+bool validateCatalogFile(const string& filename) {
+    LoadProfile profile;
+    vector<Course> courses;
+    if (!parseCourseFile(filename, courses, 0, false, &profile)) return false;
+
+    CourseBST bst;
+    CatalogReport report;
+    bst.bulkLoad(move(courses), &report.duplicateCourses);
+    bst.resolvePrerequisites();
+    report.invalidLines = profile.invalidLines;
+    validateCatalog(bst, report);
+    printCatalogReport(report);
+    return true;
+}
+
+/***************************************************************
+ * compareLoadModes
+ *
+ * Parses the file once, then builds one tree with insert-based loading and another with bulk building
+ * from the same courses. Prints the time, key comparisons and resulting height of each so they can be compared.
+ * Then times the whole parse + bulk build on one thread against the same work split across every hardware thread.
+ ***************************************************************/
+void compareLoadModes(const string& filename) {
+    vector<Course> courses;
+    if (!parseCourseFile(filename, courses, 1, false)) {
+        return;
+    }
+
+    cout << "Comparing load modes on " << filename << " (" << courses.size() << " courses):" << endl;
+
+    // Insert-based: one root-to-leaf descent per course (the input copy is made before the clock starts)
+    CourseBST inserted;
+    vector<Course> insertInput = courses;
+    auto start = chrono::steady_clock::now();
+    for (auto& course : insertInput) {
+        inserted.insert(move(course));
+    }
+    chrono::duration<double, milli> insertTime = chrono::steady_clock::now() - start;
+
+    // Bulk: sort once and build bottom-up (the input copy is made before the clock starts)
+    CourseBST bulk;
+    vector<Course> bulkInput = courses;
+    start = chrono::steady_clock::now();
+    bulk.bulkLoad(move(bulkInput));
+    chrono::duration<double, milli> bulkTime = chrono::steady_clock::now() - start;
+
+    cout << "  Insert-based: " << insertTime.count() << " ms, "
+        << inserted.keyComparisons() << " comparisons, height " << inserted.height() << endl;
+    cout << "  Bulk build:   " << bulkTime.count() << " ms, "
+        << bulk.keyComparisons() << " comparisons, height " << bulk.height() << endl;
+
+    // Whole pipeline: parse + bulk build, single-threaded and then on every hardware thread
+    size_t hardwareThreads = max(1u, thread::hardware_concurrency());
+    for (size_t threads : { size_t(1), hardwareThreads }) {
+        CourseBST tree;
+        vector<Course> parsed;
+        start = chrono::steady_clock::now();
+        parseCourseFile(filename, parsed, threads, false);
+        tree.bulkLoad(move(parsed));
+        chrono::duration<double, milli> loadTime = chrono::steady_clock::now() - start;
+        cout << "  Parse + bulk build on " << threads << (threads == 1 ? " thread:  " : " threads: ")
+            << loadTime.count() << " ms" << endl;
+    }
+}
+
+/***************************************************************
+ * CourseSnapshot Class
+ *
+ * A versioned, checksummed binary copy of a loaded catalog, written next to the CSV after a successful load
+ * (as "<csv name>.snapshot") and memory-mapped on later starts. Queries are answered straight from the mapped bytes:
+ * nothing is parsed and nothing is allocated per lookup. Layout, in native byte order (it is a local cache, not an interchange format):
+ *
+ *   Header   magic, version, the CSV's size / modification time / content hash, section sizes, payload checksum
+ *   Slots    open-addressing hash index: [32 bits of the key's hash, course index], a power-of-two number of them
+ *   Courses  one fixed-size record per course in sorted order: offsets into the string pool, its range of edges, its CSV row hash
+ *   Edges    one per prerequisite: target course index (or noTarget if it is dangling) and the prerequisite ID's offset
+ *   Strings  every course number, course name and dangling prerequisite ID, back to back
+ *
+ * open() rejects a snapshot whose magic, version, sizes or checksum are wrong, or whose CSV has changed size,
+ * modification time or content since it was written; the caller then reloads the CSV and writes a new one.
+ ***************************************************************/
+class CourseSnapshot {
+public:
+    // Edge target of a dangling prerequisite, and the result of a failed find()
+    static constexpr uint32_t noTarget = UINT32_MAX;
+
+private:
+    static constexpr char magicBytes[8] = { 'A', 'B', 'C', 'U', 'S', 'N', 'A', 'P' };
+    static constexpr uint32_t formatVersion = 2;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint64_t sourceHash;
+        uint64_t courseCount;
+        uint64_t edgeCount;
+        uint64_t slotCount;
+        uint64_t stringBytes;
+        uint64_t payloadChecksum;
+    };
+
+    struct Slot {
+        uint32_t hash;
+        uint32_t course;
+    };
+
+    struct Record {
+        uint32_t numberOffset;
+        uint32_t numberLength;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t firstEdge;
+        uint32_t edgeCount;
+        uint64_t rowHash;
+    };
+
+    struct Edge {
+        uint32_t target;
+        uint32_t idOffset;
+        uint32_t idLength;
+    };
+
+    MappedFile file;
+    Header header;
+    const Slot* slots;
+    const Record* records;
+    const Edge* edges;
+    const char* strings;
+
+    // Size of each section in bytes, given the counts in a header
+    static size_t payloadSize(const Header& h) {
+        return h.slotCount * sizeof(Slot) + h.courseCount * sizeof(Record) + h.edgeCount * sizeof(Edge) + h.stringBytes;
+    }
+
+    // The CSV's modification time as a plain integer (its clock's ticks since that clock's epoch)
+    static int64_t modifiedTime(const string& path) {
+        error_code error;
+        auto time = filesystem::last_write_time(path, error);
+        return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    string_view text(uint32_t offset, uint32_t length) const {
+        return string_view(strings + offset, length);
+    }
+
+public:
+    CourseSnapshot() : header(), slots(nullptr), records(nullptr), edges(nullptr), strings(nullptr) {}
+
+    // Where the snapshot for a CSV file lives
+    static string pathFor(const string& csvFilename) {
+        return csvFilename + ".snapshot";
+    }
+
+    // Maps the snapshot for csvFilename and checks that it is intact and still matches the CSV.
+    // On failure, returns false with the reason (the snapshot is then unusable until the next successful open).
+    bool open(const string& csvFilename, string& reason) {
+        close();
+        if (!file.open(pathFor(csvFilename))) {
+            reason = "no snapshot";
+            return false;
+        }
+        if (file.size() < sizeof(Header)) {
+            reason = "snapshot is truncated";
+            close();
+            return false;
+        }
+
+        memcpy(&header, file.data(), sizeof(Header));
+        if (memcmp(header.magic, magicBytes, sizeof(magicBytes)) != 0 || header.headerSize != sizeof(Header)) {
+            reason = "not a snapshot file";
+            close();
+            return false;
+        }
+        if (header.version != formatVersion) {
+            reason = "snapshot format version " + to_string(header.version) + " is not supported";
+            close();
+            return false;
+        }
+        if (file.size() != sizeof(Header) + payloadSize(header) ||
+            hashBytes(file.data() + sizeof(Header), payloadSize(header)) != header.payloadChecksum) {
+            reason = "snapshot checksum does not match";
+            close();
+            return false;
+        }
+
+        // The CSV must be exactly the one the snapshot was built from
+        MappedFile csv;
+        if (!csv.open(csvFilename)) {
+            reason = "could not open " + csvFilename;
+            close();
+            return false;
+        }
+        if (csv.size() != header.sourceSize || modifiedTime(csvFilename) != header.sourceModified) {
+            reason = "CSV size or modification time changed";
+            close();
+            return false;
+        }
+        if (hashBytes(csv.data(), csv.size()) != header.sourceHash) {
+            reason = "CSV contents changed";
+            close();
+            return false;
+        }
+
+        const char* section = file.data() + sizeof(Header);
+        slots = reinterpret_cast<const Slot*>(section);
+        section += header.slotCount * sizeof(Slot);
+        records = reinterpret_cast<const Record*>(section);
+        section += header.courseCount * sizeof(Record);
+        edges = reinterpret_cast<const Edge*>(section);
+        section += header.edgeCount * sizeof(Edge);
+        strings = section;
+        return true;
+    }
+
+    // Unmaps the snapshot
+    void close() {
+        file.close();
+        header = Header();
+        slots = nullptr;
+        records = nullptr;
+        edges = nullptr;
+        strings = nullptr;
+    }
+
+    // Number of courses (in sorted order, index 0 .. size() - 1)
+    size_t size() const {
+        return static_cast<size_t>(header.courseCount);
+    }
+
+    string_view courseNumber(size_t course) const {
+        return text(records[course].numberOffset, records[course].numberLength);
+    }
+
+    string_view courseName(size_t course) const {
+        return text(records[course].nameOffset, records[course].nameLength);
+    }
+
+    size_t prerequisiteCount(size_t course) const {
+        return records[course].edgeCount;
+    }
+
+    // The k-th prerequisite ID of a course, and the course index it resolves to (noTarget if it is dangling)
+    string_view prerequisiteId(size_t course, size_t k) const {
+        const Edge& edge = edges[records[course].firstEdge + k];
+        return text(edge.idOffset, edge.idLength);
+    }
+
+    uint32_t prerequisiteTarget(size_t course, size_t k) const {
+        return edges[records[course].firstEdge + k].target;
+    }
+
+    // Index of the course with this courseNumber, or noTarget. Uses the prebuilt hash index; allocates nothing.
+    uint32_t find(string_view courseNumber) const {
+        if (header.slotCount == 0) return noTarget;
+        uint64_t hash = CourseHashIndex::hashKey(courseNumber);
+        size_t mask = static_cast<size_t>(header.slotCount - 1);
+        for (size_t i = hash & mask; slots[i].course != noTarget; i = (i + 1) & mask) {
+            if (slots[i].hash == static_cast<uint32_t>(hash >> 32) && this->courseNumber(slots[i].course) == courseNumber) {
+                return slots[i].course;
+            }
+        }
+        return noTarget;
+    }
+
+    // Index of the first course whose courseNumber is >= key (size() if none), by binary search over the sorted records
+    size_t lowerBound(string_view key) const {
+        size_t lo = 0;
+        size_t hi = size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (courseNumber(mid) < key) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // Copies every course out of the snapshot, in sorted order, so a full CourseBST can be built without parsing the CSV
+    vector<Course> toCourses() const {
+        vector<Course> courses(size());
+        for (size_t i = 0; i < size(); ++i) {
+            courses[i].courseNumber = courseNumber(i);
+            courses[i].courseName = courseName(i);
+            courses[i].rowHash = records[i].rowHash;
+            courses[i].prerequisites.reserve(prerequisiteCount(i));
+            for (size_t k = 0; k < prerequisiteCount(i); ++k) {
+                courses[i].prerequisites.emplace_back(prerequisiteId(i, k));
+            }
+        }
+        return courses;
+    }
+
+    // Writes the snapshot for a freshly loaded (and resolved) tree built from csvFilename.
+    // The file is written under a temporary name and renamed into place, so a crash never leaves half a snapshot behind.
+    static bool write(const CourseBST& bst, const string& csvFilename) {
+        MappedFile csv;
+        if (!bst.prerequisitesResolved() || !csv.open(csvFilename)) return false;
+
+        Header h = Header();
+        memcpy(h.magic, magicBytes, sizeof(magicBytes));
+        h.version = formatVersion;
+        h.headerSize = sizeof(Header);
+        h.sourceSize = csv.size();
+        h.sourceModified = modifiedTime(csvFilename);
+        h.sourceHash = hashBytes(csv.data(), csv.size());
+        h.courseCount = bst.size();
+
+        // Courses and edges; a resolved prerequisite points at its target's number instead of storing the ID again
+        string pool;
+        vector<Record> courseRecords(bst.size());
+        vector<Edge> edgeRecords;
+        size_t edgeTotal = 0;
+        for (size_t id = 0; id < bst.size(); ++id) {
+            const Course& course = bst.courseAt(id);
+            Record& record = courseRecords[id];
+            record.numberOffset = static_cast<uint32_t>(pool.size());
+            record.numberLength = static_cast<uint32_t>(course.courseNumber.size());
+            pool += course.courseNumber;
+            record.nameOffset = static_cast<uint32_t>(pool.size());
+            record.nameLength = static_cast<uint32_t>(course.courseName.size());
+            pool += course.courseName;
+            record.rowHash = course.rowHash;
+            record.firstEdge = static_cast<uint32_t>(edgeTotal);
+            record.edgeCount = static_cast<uint32_t>(course.prerequisites.size());
+            edgeTotal += course.prerequisites.size();
+        }
+        for (size_t id = 0; id < bst.size(); ++id) {
+            const Course& course = bst.courseAt(id);
+            for (size_t k = 0; k < course.prerequisites.size(); ++k) {
+                const Course* target = course.prerequisiteLinks[k];
+                Edge edge;
+                if (target) {
+                    edge.target = static_cast<uint32_t>(target->id);
+                    edge.idOffset = courseRecords[target->id].numberOffset;
+                }
+                else {
+                    edge.target = noTarget;
+                    edge.idOffset = static_cast<uint32_t>(pool.size());
+                    pool += course.prerequisites[k];
+                }
+                edge.idLength = static_cast<uint32_t>(course.prerequisites[k].size());
+                edgeRecords.push_back(edge);
+            }
+        }
+        // The string pool is addressed with 32-bit offsets
+        if (pool.size() > UINT32_MAX) return false;
+
+        // Hash index at no more than 50% load (courseNumbers in the tree are unique)
+        size_t slotCount = 16;
+        while (slotCount < 2 * bst.size()) slotCount *= 2;
+        vector<Slot> slotTable(slotCount, Slot{ 0, noTarget });
+        for (size_t id = 0; id < bst.size(); ++id) {
+            uint64_t hash = CourseHashIndex::hashKey(bst.courseAt(id).courseNumber);
+            size_t i = hash & (slotCount - 1);
+            while (slotTable[i].course != noTarget) {
+                i = (i + 1) & (slotCount - 1);
+            }
+            slotTable[i] = Slot{ static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(id) };
+        }
+
+        h.edgeCount = edgeRecords.size();
+        h.slotCount = slotCount;
+        h.stringBytes = pool.size();
+
+        // Lay the payload out in one buffer so it can be checksummed and written in one go
+        string payload;
+        payload.reserve(payloadSize(h));
+        payload.append(reinterpret_cast<const char*>(slotTable.data()), slotTable.size() * sizeof(Slot));
+        payload.append(reinterpret_cast<const char*>(courseRecords.data()), courseRecords.size() * sizeof(Record));
+        payload.append(reinterpret_cast<const char*>(edgeRecords.data()), edgeRecords.size() * sizeof(Edge));
+        payload += pool;
+        h.payloadChecksum = hashBytes(payload.data(), payload.size());
+
+        string target = pathFor(csvFilename);
+        string temporary = target + ".tmp";
+        {
+            ofstream out(temporary, ios::binary | ios::trunc);
+            if (!out.is_open()) return false;
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(payload.data(), static_cast<streamsize>(payload.size()));
+            if (!out) return false;
+        }
+        error_code error;
+        filesystem::rename(temporary, target, error);
+        return !error;
+    }
+};
+
+/***************************************************************
+ * FrozenCatalog Class
+ *
+ * A read-only copy of a resolved CourseBST, compacted into flat columns for catalogs that don't change between reloads.
+ * Courses are numbered in sorted order. Their numbers, names and prerequisite ranges are separate arrays in that order,
+ * and the text lives in one buffer: every number first, then every name, then the IDs of dangling prerequisites.
+ * So printAll and range listings are sequential scans, and a prerequisite is an index into the same columns.
+ * Searching uses a separate array of keys laid out in Eytzinger (breadth-first) order: the root is slot 1, and slot k's
+ * children are slots 2k and 2k + 1. The top levels of the search share a few cache lines, and the next slots are always
+ * in a predictable place, so a lookup never follows a pointer. Each slot packs the first sixteen bytes of its number, so
+ * numbers that share a long prefix ("CSCI000123", "CSCI000124") are still told apart without reading the text.
+ * Has the same read interface as CourseSnapshot, so the same query code can answer from either.
+ ***************************************************************/
+class FrozenCatalog {
+public:
+    // Target of a dangling prerequisite, and the result of a failed find()
+    static constexpr uint32_t noTarget = UINT32_MAX;
+
+private:
+    struct TextRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    // packCourseKey of the first eight bytes of a courseNumber and of the next eight
+    struct SearchKey {
+        uint64_t head;
+        uint64_t tail;
+
+        explicit SearchKey(string_view courseNumber = string_view())
+            : head(packCourseKey(courseNumber)),
+              tail(packCourseKey(courseNumber.size() > 8 ? courseNumber.substr(8) : string_view())) {}
+    };
+
+    // Search order: keys and the sorted position of the course in each slot (slot 0 is unused)
+    vector<SearchKey> searchKeys;
+    vector<uint32_t> searchCourses;
+    // Sorted order, one entry per course
+    vector<TextRef> numbers;
+    vector<TextRef> names;
+    // Course i's prerequisites are entries firstPrerequisite[i] up to firstPrerequisite[i + 1] of the two columns below
+    vector<uint32_t> firstPrerequisite;
+    vector<uint32_t> prerequisiteTargets;
+    vector<TextRef> prerequisiteIds;
+    string text;
+
+    string_view textOf(TextRef ref) const {
+        return string_view(text.data() + ref.offset, ref.length);
+    }
+
+    TextRef append(string_view value) {
+        TextRef ref{ static_cast<uint32_t>(text.size()), static_cast<uint32_t>(value.size()) };
+        text.append(value.data(), value.size());
+        return ref;
+    }
+
+    // Fills the search slots under slot k with the courses from position next on, in order; returns the next unused position
+    size_t layOut(size_t k, size_t next) {
+        if (k >= searchKeys.size()) return next;
+        next = layOut(2 * k, next);
+        searchKeys[k] = SearchKey(courseNumber(next));
+        searchCourses[k] = static_cast<uint32_t>(next);
+        return layOut(2 * k + 1, next + 1);
+    }
+
+    // Search slot of the first course whose courseNumber is >= the given one, or 0 if there is none
+    size_t lowerBoundSlot(string_view courseNumber) const {
+        SearchKey key(courseNumber);
+        size_t count = searchKeys.size();
+        size_t k = 1;
+        while (k < count) {
+            // Go right past smaller keys; the text is only read when all sixteen packed bytes tie
+            const SearchKey& slot = searchKeys[k];
+            bool less = slot.head != key.head ? slot.head < key.head
+                : slot.tail != key.tail ? slot.tail < key.tail
+                : textOf(numbers[searchCourses[k]]) < courseNumber;
+            k = 2 * k + less;
+        }
+        // The search ran off the bottom of the tree; the answer is where it last went left, so undo the trailing right turns
+        // and that left turn (one more than the number of low 1 bits)
+        return k >> (lowestSetBit(~static_cast<uint64_t>(k)) + 1);
+    }
+
+public:
+    // Replaces the contents with a copy of a resolved tree's courses. Returns false (leaving the catalog empty) if the tree
+    // wasn't resolved or its text doesn't fit 32-bit offsets.
+    bool freeze(const CourseBST& bst) {
+        clear();
+        if (!bst.prerequisitesResolved()) return false;
+
+        size_t courseCount = bst.size();
+        size_t prerequisiteTotal = 0;
+        size_t textBytes = 0;
+        for (size_t id = 0; id < courseCount; ++id) {
+            const Course& course = bst.courseAt(id);
+            prerequisiteTotal += course.prerequisites.size();
+            textBytes += course.courseNumber.size() + course.courseName.size();
+        }
+        if (textBytes > UINT32_MAX) return false;
+
+        numbers.reserve(courseCount);
+        names.reserve(courseCount);
+        firstPrerequisite.reserve(courseCount + 1);
+        prerequisiteTargets.reserve(prerequisiteTotal);
+        prerequisiteIds.reserve(prerequisiteTotal);
+        text.reserve(textBytes);
+        for (size_t id = 0; id < courseCount; ++id) {
+            numbers.push_back(append(bst.courseAt(id).courseNumber));
+        }
+        for (size_t id = 0; id < courseCount; ++id) {
+            names.push_back(append(bst.courseAt(id).courseName));
+        }
+        // A resolved prerequisite reuses its target's number; only dangling IDs add text
+        for (size_t id = 0; id < courseCount; ++id) {
+            const Course& course = bst.courseAt(id);
+            firstPrerequisite.push_back(static_cast<uint32_t>(prerequisiteTargets.size()));
+            for (size_t k = 0; k < course.prerequisites.size(); ++k) {
+                const Course* target = course.prerequisiteLinks[k];
+                prerequisiteTargets.push_back(target ? static_cast<uint32_t>(target->id) : noTarget);
+                prerequisiteIds.push_back(target ? numbers[target->id] : append(course.prerequisites[k]));
+            }
+            if (text.size() > UINT32_MAX) {
+                clear();
+                return false;
+            }
+        }
+        firstPrerequisite.push_back(static_cast<uint32_t>(prerequisiteTargets.size()));
+
+        searchKeys.assign(courseCount + 1, SearchKey());
+        searchCourses.assign(courseCount + 1, noTarget);
+        layOut(1, 0);
+        return true;
+    }
+
+    void clear() {
+        searchKeys.clear();
+        searchCourses.clear();
+        numbers.clear();
+        names.clear();
+        firstPrerequisite.clear();
+        prerequisiteTargets.clear();
+        prerequisiteIds.clear();
+        text.clear();
+    }
+
+    // Number of courses (in sorted order, index 0 .. size() - 1)
+    size_t size() const {
+        return numbers.size();
+    }
+
+    string_view courseNumber(size_t course) const {
+        return textOf(numbers[course]);
+    }
+
+    string_view courseName(size_t course) const {
+        return textOf(names[course]);
+    }
+
+    size_t prerequisiteCount(size_t course) const {
+        return firstPrerequisite[course + 1] - firstPrerequisite[course];
+    }
+
+    // The k-th prerequisite ID of a course, and the course index it resolves to (noTarget if it is dangling)
+    string_view prerequisiteId(size_t course, size_t k) const {
+        return textOf(prerequisiteIds[firstPrerequisite[course] + k]);
+    }
+
+    uint32_t prerequisiteTarget(size_t course, size_t k) const {
+        return prerequisiteTargets[firstPrerequisite[course] + k];
+    }
+
+    // Index of the course with this courseNumber, or noTarget
+    uint32_t find(string_view courseNumber) const {
+        size_t k = lowerBoundSlot(courseNumber);
+        if (k == 0 || this->courseNumber(searchCourses[k]) != courseNumber) return noTarget;
+        return searchCourses[k];
+    }
+
+    // Index of the first course whose courseNumber is >= key (size() if none)
+    size_t lowerBound(string_view key) const {
+        size_t k = lowerBoundSlot(key);
+        return k == 0 ? size() : searchCourses[k];
+    }
+
+    // Prints every course in sorted order, like CourseBST::printAll
+    void printAll() const {
+        for (size_t i = 0; i < size(); ++i) {
+            bufferedOut << courseNumber(i) << ", " << courseName(i) << '\n';
+        }
+    }
+
+    // Bytes held by the columns and the text
+    size_t memoryBytes() const {
+        return searchKeys.capacity() * sizeof(SearchKey) + searchCourses.capacity() * sizeof(uint32_t)
+            + (numbers.capacity() + names.capacity() + prerequisiteIds.capacity()) * sizeof(TextRef)
+            + (firstPrerequisite.capacity() + prerequisiteTargets.capacity()) * sizeof(uint32_t) + text.capacity();
+    }
+};
+
+// Most "Did you mean" suggestions shown when a course isn't found
+const size_t maxSuggestions = 5;
+
+/***************************************************************
+ * ResponseCache Class
+ *
+ * Bounded LRU cache of fully formatted query responses, keyed by the normalized query. A handful of courses get most of
+ * the lookups, so keeping their finished text skips the searches, the prerequisite names and the formatting.
+ * Entries are allocated as the cache fills (so an idle thread's cache costs nothing) and linked from newest to oldest by
+ * index; a full cache reuses the oldest entry.
+ * The owner must clear() it whenever the catalog changes. Not thread-safe: each thread that answers queries keeps its own.
+ * Counts hits and misses so the capacity can be sized from real traffic.
+ ***************************************************************/
+class ResponseCache {
+public:
+    explicit ResponseCache(size_t capacity)
+        : limit(min<size_t>(capacity, none)), newest(none), oldest(none), hitCount(0), missCount(0) {}
+
+    // The cached response for key, or nullptr; a hit becomes the newest entry
+    const string* find(string_view key) {
+        auto found = lookup.find(key);
+        if (found == lookup.end()) {
+            ++missCount;
+            return nullptr;
+        }
+        ++hitCount;
+        uint32_t slot = found->second;
+        unlink(slot);
+        pushNewest(slot);
+        return &entries[slot].response;
+    }
+
+    // Caches response for key (which must not be cached already), evicting the least recently used entry if full
+    void store(string_view key, string response) {
+        if (limit == 0) return;
+        uint32_t slot;
+        if (entries.size() < limit) {
+            slot = static_cast<uint32_t>(entries.size());
+            entries.emplace_back();
+        }
+        else {
+            slot = oldest;
+            unlink(slot);
+            lookup.erase(string_view(entries[slot].key));
+        }
+        Entry& entry = entries[slot];
+        entry.key.assign(key.data(), key.size());
+        entry.response = move(response);
+        lookup.emplace(string_view(entry.key), slot);
+        pushNewest(slot);
+    }
+
+    // Drops every entry (the counters keep counting)
+    void clear() {
+        lookup.clear();
+        entries.clear();
+        newest = oldest = none;
+    }
+
+    size_t hits() const {
+        return hitCount;
+    }
+
+    size_t misses() const {
+        return missCount;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    size_t capacity() const {
+        return limit;
+    }
+
+private:
+    // Link value meaning "no entry"
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Entry {
+        string key;
+        string response;
+        // Neighbors in recency order
+        uint32_t newer = none;
+        uint32_t older = none;
+    };
+
+    // A deque never moves its entries as it grows, so the lookup's views into the keys stay valid
+    deque<Entry> entries;
+    // Views into the entries' own keys
+    unordered_map<string_view, uint32_t> lookup;
+    size_t limit;
+    uint32_t newest;
+    uint32_t oldest;
+    size_t hitCount;
+    size_t missCount;
+
+    void unlink(uint32_t slot) {
+        Entry& entry = entries[slot];
+        if (entry.newer != none) entries[entry.newer].older = entry.older;
+        else newest = entry.older;
+        if (entry.older != none) entries[entry.older].newer = entry.newer;
+        else oldest = entry.newer;
+        entry.newer = entry.older = none;
+    }
+
+    void pushNewest(uint32_t slot) {
+        entries[slot].older = newest;
+        if (newest != none) entries[newest].newer = slot;
+        newest = slot;
+        if (oldest == none) oldest = slot;
+    }
+};
+
+/***************************************************************
+ * printCacheStats
+ *
+ * Shows how well a response cache has been doing, so its capacity can be tuned.
+ ***************************************************************/
+void printCacheStats(const ResponseCache& cache) {
+    size_t lookups = cache.hits() + cache.misses();
+    bufferedOut << "Response cache: " << cache.hits() << " hits, " << cache.misses() << " misses ("
+        << (lookups ? 100.0 * cache.hits() / lookups : 0.0) << "% hit rate), "
+        << cache.size() << " of " << cache.capacity() << " entries used.\n";
+}
+
+/***************************************************************
+ * parseWholeNumber
+ *
+ * Reads a whole decimal value (a flag's, or a typed answer) into number; returns false if it isn't one
+ * or falls outside [low, high]. A sign, trailing text or an out-of-range value is rejected rather than wrapped or cut off.
+ ***************************************************************/
+bool parseWholeNumber(const string& value, size_t low, size_t high, size_t& number) {
+    const char* end = value.data() + value.size();
+    from_chars_result result = from_chars(value.data(), end, number);
+    return result.ec == errc() && result.ptr == end && number >= low && number <= high;
+}
+
+/***************************************************************
+ * readUserLine
+ *
+ * getline from cin for the menu's prompts, counting the time spent waiting in metrics.inputWaitNanos
+ * so a command's recorded latency covers only its own work.
+ ***************************************************************/
+bool readUserLine(string& line) {
+    ABCU_METRIC(uint64_t start = metricsClock());
+    bool ok = static_cast<bool>(getline(cin, line));
+    ABCU_METRIC(metrics.inputWaitNanos.fetch_add(metricsClock() - start, memory_order_relaxed));
+    return ok;
+}
+
+/***************************************************************
+ * printMetrics
+ *
+ * What the Show Statistics option prints: the last load's phases and counts, the tree's shape (when the tree holds
+ * the catalog), the search probe and seek comparison histograms, per-command latency, and the response cache.
+ ***************************************************************/
+void printMetrics(const CourseBST& bst, bool treeReady, const ResponseCache& responses) {
+    if (treeReady) {
+        // A perfectly balanced tree of n nodes is ceil(log2(n + 1)) levels high
+        int minimumHeight = 0;
+        while ((size_t(1) << minimumHeight) <= bst.size()) ++minimumHeight;
+        bufferedOut << "Tree: " << bst.size() << " courses, height " << bst.height() << " (" << minimumHeight
+            << " at best), average depth " << (bst.size() ? static_cast<double>(bst.totalDepth()) / bst.size() : 0.0) << '\n';
+    }
+    else {
+        bufferedOut << "Tree: not built (courses are answered from the snapshot)\n";
+    }
+    printCacheStats(responses);
+
+#if defined(ABCU_METRICS)
+    // Names of the menu options, by number
+    static const char* const commandNames[Metrics::commandCount] = {
+        "(invalid option)", "Load Data Structure", "Print Course List", "Print Course", "Compare Load Modes",
+        "Print Full Prerequisite Chain", "Plan Semesters", "List Courses by Prefix", "List Courses in Range",
+        "Exit", "Search Course Titles", "Show Statistics", "Validate Catalog"
+    };
+    auto milliseconds = [](uint64_t nanos) {
+        return nanos / 1e6;
+    };
+    LoadProfile load = metrics.loadSnapshot();
+    if (load.totalNanos) {
+        bufferedOut << "Last load: " << load.lines << " lines in " << milliseconds(load.totalNanos) << " ms ("
+            << static_cast<uint64_t>(load.lines / (load.totalNanos / 1e9)) << " rows/s)\n";
+        bufferedOut << "  read " << milliseconds(load.readNanos) << " ms, split " << milliseconds(load.splitNanos)
+            << " ms, normalize " << milliseconds(load.normalizeNanos) << " ms, insert " << milliseconds(load.insertNanos)
+            << " ms, resolve " << milliseconds(load.resolveNanos) << " ms\n";
+        bufferedOut << "  " << load.courses << " courses loaded, " << load.invalidLines << " invalid lines and "
+            << load.duplicates << " duplicates skipped, " << load.danglingPrerequisites << " dangling prerequisites\n";
+    }
+    else {
+        bufferedOut << "Last load: none from the CSV yet\n";
+    }
+
+    // Mean, and the count below which 99% of samples fall, then the non-empty buckets
+    auto printCounts = [&](const char* title, const CountHistogram& histogram) {
+        uint64_t samples = histogram.samples();
+        bufferedOut << title << ": " << samples;
+        if (samples == 0) {
+            bufferedOut << '\n';
+            return;
+        }
+        uint64_t weighted = 0;
+        uint64_t seen = 0;
+        size_t p99 = CountHistogram::bucketCount;
+        for (size_t count = 0; count < CountHistogram::bucketCount; ++count) {
+            uint64_t hits = histogram.buckets[count].load(memory_order_relaxed);
+            weighted += hits * count;
+            seen += hits;
+            if (p99 == CountHistogram::bucketCount && seen >= samples - samples / 100) p99 = count;
+        }
+        bufferedOut << ", mean " << static_cast<double>(weighted) / samples << ", p99 " << p99 << '\n' << " ";
+        for (size_t count = 0; count < CountHistogram::bucketCount; ++count) {
+            uint64_t hits = histogram.buckets[count].load(memory_order_relaxed);
+            if (hits) bufferedOut << ' ' << count << (count + 1 == CountHistogram::bucketCount ? "+" : "") << ':' << hits;
+        }
+        bufferedOut << '\n';
+    };
+    ThreadCounts counts;
+    metrics.counts(counts);
+    printCounts("Course searches (hash slots probed per search)", counts.searchProbes);
+    printCounts("Ordered seeks (tree nodes compared per seek)", counts.seekComparisons);
+
+    bufferedOut << "Commands (time spent working, not waiting for input):\n";
+    for (size_t command = 0; command < Metrics::commandCount; ++command) {
+        const LatencyHistogram& latency = metrics.commands[command];
+        uint64_t runs = latency.samples();
+        if (runs == 0) continue;
+        bufferedOut << "  " << commandNames[command] << ": " << runs << (runs == 1 ? " run" : " runs") << ", mean "
+            << milliseconds(latency.totalNanos.load(memory_order_relaxed) / runs) << " ms, p99 under "
+            << milliseconds(latency.percentile(0.99)) << " ms, max " << milliseconds(latency.maxNanos.load(memory_order_relaxed)) << " ms\n";
+    }
+#else
+    bufferedOut << "Metrics were compiled out (built with ABCU_NO_METRICS).\n";
+#endif
+}
+
+/***************************************************************
+ * formatCourseInfo
+ *
+ * Writes what printCourseInfo shows for courseKey (already upper-cased and trimmed): the course's name and prerequisites
+ * (if any). If a prerequisite is also in the BST, its name is shown too. Prerequisites are read through the links set up by
+ * resolvePrerequisites; only a tree that hasn't been resolved yet falls back to searching for each one.
+ * If the course isn't found, suggests the closest courses from the title index (which must cover the resolved tree).
+ ***************************************************************/
+void formatCourseInfo(const CourseBST& bst, TitleIndex& titles, const string& courseKey, StringOutput out) {
+    // Search for the course in the BST
+    Course* course = bst.search(courseKey);
+    if (!course) {
+        // If the course can't be found, inform the user and offer the nearest matches
+        out << "Course not found.\n";
+        vector<TitleMatch> suggestions = titles.search(courseKey, maxSuggestions);
+        if (!suggestions.empty()) {
+            out << "Did you mean:\n";
+            for (const TitleMatch& match : suggestions) {
+                const Course& suggestion = bst.courseAt(match.course);
+                out << "  " << suggestion.courseNumber << ", " << suggestion.courseName << '\n';
+            }
+        }
+        return;
+    }
+
+    // Print the main course info: number + title
+    out << course->courseNumber << ", " << course->courseName << '\n';
+
+    // If this course has prerequisites, display them
+    if (!course->prerequisites.empty()) {
+        out << "Prerequisites: ";
+        bool firstPrinted = false;
+
+        // For each prerequisite ID, follow its link (or search the BST) to get the full name
+        bool linked = bst.prerequisitesResolved();
+        for (size_t i = 0; i < course->prerequisites.size(); ++i) {
+            string_view prereqID = course->prerequisites[i];
+            if (firstPrinted) {
+                out << ", ";
+            }
+            else {
+                firstPrinted = true;
+            }
+
+            const Course* prereqCourse = linked ? course->prerequisiteLinks[i] : bst.search(prereqID);
+            if (prereqCourse) {
+                // Print "CSCI101: Introduction to Programming in C++"
+                out << prereqCourse->courseNumber << ": " << prereqCourse->courseName;
+            }
+            else {
+                // If not found, show only the ID
+                out << prereqID << ": None Required";
+            }
+        }
+        out << '\n';
+    }
+    else {
+        // This course has no prerequisites
+        out << "Prerequisites: None\n";
+    }
+}
+
+/***************************************************************
+ * formatCourseInfo (snapshot)
+ *
+ * The same response, answered from a mapped snapshot: one hash probe for the course,
+ * and each prerequisite's name comes from its stored link. Output is identical to the BST version.
+ ***************************************************************/
+void formatCourseInfo(const CourseSnapshot& snapshot, TitleIndex& titles, const string& courseKey, StringOutput out) {
+    uint32_t course = snapshot.find(courseKey);
+    if (course == CourseSnapshot::noTarget) {
+        out << "Course not found.\n";
+        vector<TitleMatch> suggestions = titles.search(courseKey, maxSuggestions);
+        if (!suggestions.empty()) {
+            out << "Did you mean:\n";
+            for (const TitleMatch& match : suggestions) {
+                out << "  " << snapshot.courseNumber(match.course) << ", " << snapshot.courseName(match.course) << '\n';
+            }
+        }
+        return;
+    }
+
+    out << snapshot.courseNumber(course) << ", " << snapshot.courseName(course) << '\n';
+    if (snapshot.prerequisiteCount(course) == 0) {
+        out << "Prerequisites: None\n";
+        return;
+    }
+
+    out << "Prerequisites: ";
+    for (size_t k = 0; k < snapshot.prerequisiteCount(course); ++k) {
+        if (k) out << ", ";
+        uint32_t target = snapshot.prerequisiteTarget(course, k);
+        if (target != CourseSnapshot::noTarget) {
+            out << snapshot.courseNumber(target) << ": " << snapshot.courseName(target);
+        }
+        else {
+            out << snapshot.prerequisiteId(course, k) << ": None Required";
+        }
+    }
+    out << '\n';
+}
+
+/***************************************************************
+ * printCourseInfo
+ *
+ * Prompts the user for a courseNumber and prints its name and prerequisites (see formatCourseInfo), from the tree or
+ * the snapshot, whichever currently holds the catalog. Responses are kept in cache, so asking about the same course
+ * again only prints the saved text.
+ ***************************************************************/
+template <typename Catalog>
+void printCourseInfo(const Catalog& catalog, TitleIndex& titles, ResponseCache& cache) {
+    bufferedOut << "What course do you want to know about? ";
+    string userInput;
+    bufferedOut.flush();
+    readUserLine(userInput);
+    string courseKey = toUpperTrim(userInput);
+
+    if (const string* cached = cache.find(courseKey)) {
+        bufferedOut << *cached;
+        return;
+    }
+    string response;
+    formatCourseInfo(catalog, titles, courseKey, StringOutput{ response });
+    bufferedOut << response;
+    cache.store(courseKey, move(response));
+}
+
+/***************************************************************
+ * printPrerequisiteChain
+ *
+ * Prompts the user for a courseNumber and prints every course it requires, directly or through other prerequisites,
+ * in sorted order. Any prerequisite cycle reachable from the course is reported with the courses that form it.
+ * Entering ALL computes the chain of every course instead and reports how long that took.
+ ***************************************************************/
+void printPrerequisiteChain(const CourseBST& bst, PrerequisiteGraph& graph) {
+    bufferedOut << "What course do you want the full prerequisite chain for (or ALL to time every course)? ";
+    string userInput;
+    bufferedOut.flush();
+    readUserLine(userInput);
+    string courseKey = toUpperTrim(userInput);
+
+    if (courseKey == "ALL") {
+        auto start = chrono::steady_clock::now();
+        size_t totalEntries = 0;
+        for (uint32_t id = 0; id < graph.size(); ++id) {
+            totalEntries += graph.transitivePrerequisites(id).size();
+        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        bufferedOut << "Computed full prerequisite chains for " << graph.size() << " courses (" << totalEntries
+            << " entries in total) in " << elapsed.count() << " ms.\n";
+        return;
+    }
+
+    const Course* course = bst.search(courseKey);
+    if (!course) {
+        bufferedOut << "Course not found.\n";
+        return;
+    }
+    uint32_t id = static_cast<uint32_t>(course->id);
+
+    bufferedOut << course->courseNumber << ", " << course->courseName << '\n';
+    const vector<uint32_t>& chain = graph.transitivePrerequisites(id);
+    if (chain.empty()) {
+        bufferedOut << "Full prerequisite chain: None\n";
+        return;
+    }
+
+    bufferedOut << "Full prerequisite chain (" << chain.size() << " courses):\n";
+    for (uint32_t prerequisite : chain) {
+        const Course& entry = bst.courseAt(prerequisite);
+        bufferedOut << "  " << entry.courseNumber << ", " << entry.courseName << '\n';
+    }
+
+    // Report each cycle in the chain once (every course on a cycle is in the chain, so checking the chain is enough)
+    vector<bool> reported(graph.size(), false);
+    for (uint32_t prerequisite : chain) {
+        if (!graph.onCycle(prerequisite) || reported[prerequisite]) continue;
+
+        vector<uint32_t> cycle = graph.cycleThrough(prerequisite);
+        bufferedOut << "WARNING: Prerequisite cycle: ";
+        for (size_t i = 0; i < cycle.size(); ++i) {
+            bufferedOut << (i ? " -> " : "") << bst.courseAt(cycle[i]).courseNumber;
+        }
+        bufferedOut << '\n';
+
+        // Don't report the same cycle again from another course on it
+        for (uint32_t member : cycle) reported[member] = true;
+    }
+}
+
+/***************************************************************
+ * printSemesterPlan
+ *
+ * Prompts the user for the courses they want to take and a per-semester course limit, then prints a semester-by-semester
+ * plan that covers those courses and all of their prerequisites, taking every prerequisite before the courses that need it.
+ ***************************************************************/
+void printSemesterPlan(const CourseBST& bst, SemesterPlanner& planner) {
+    bufferedOut << "Which courses do you want to plan for (separated by commas or spaces)? ";
+    string userInput;
+    bufferedOut.flush();
+    readUserLine(userInput);
+
+    // Split on commas and whitespace, then look each course up
+    vector<uint32_t> targets;
+    for (char& c : userInput) {
+        if (c == ',') c = ' ';
+    }
+    size_t start = userInput.find_first_not_of(" \t\r\n");
+    while (start != string::npos) {
+        size_t end = userInput.find_first_of(" \t\r\n", start);
+        string courseKey = toUpperTrim(userInput.substr(start, end == string::npos ? string::npos : end - start));
+        const Course* course = bst.search(courseKey);
+        if (course) {
+            targets.push_back(static_cast<uint32_t>(course->id));
+        }
+        else {
+            bufferedOut << "WARNING: Course not found (skipped): " << courseKey << '\n';
+        }
+        start = end == string::npos ? end : userInput.find_first_not_of(" \t\r\n", end);
+    }
+    if (targets.empty()) {
+        bufferedOut << "No courses to plan.\n";
+        return;
+    }
+
+    // Ask until the limit is a whole number in range; a blank line (or the end of input) means no limit
+    const size_t maxPerTermLimit = 1000;
+    size_t perTermLimit = 0;
+    for (;;) {
+        bufferedOut << "Maximum courses per semester (0 for no limit)? ";
+        string limitInput;
+        bufferedOut.flush();
+        if (!readUserLine(limitInput)) break;
+        limitInput = toUpperTrim(limitInput);
+        if (limitInput.empty()) break;
+        size_t typed;
+        if (parseWholeNumber(limitInput, 0, maxPerTermLimit, typed)) {
+            perTermLimit = typed;
+            break;
+        }
+        bufferedOut << "Please enter a whole number from 0 to " << maxPerTermLimit << ".\n";
+    }
+
+    SemesterPlan plan = planner.plan(targets, perTermLimit);
+    for (size_t term = 0; term < plan.semesters.size(); ++term) {
+        bufferedOut << "Semester " << term + 1 << ": ";
+        for (size_t i = 0; i < plan.semesters[term].size(); ++i) {
+            bufferedOut << (i ? ", " : "") << bst.courseAt(plan.semesters[term][i]).courseNumber;
+        }
+        bufferedOut << '\n';
+    }
+    if (!plan.blocked.empty()) {
+        bufferedOut << "WARNING: These courses can't be scheduled because of a prerequisite cycle: ";
+        for (size_t i = 0; i < plan.blocked.size(); ++i) {
+            bufferedOut << (i ? ", " : "") << bst.courseAt(plan.blocked[i]).courseNumber;
+        }
+        bufferedOut << '\n';
+    }
+}
+
+/***************************************************************
+ * CourseKeyRange Struct
+ *
+ * A run of consecutive courseNumbers to list: every key starting with first (a prefix query),
+ * or every key from first through last inclusive (a range query). Keys are normalized like toUpperTrim.
+ ***************************************************************/
+struct CourseKeyRange {
+    string first;
+    string last;
+    bool prefix = false;
+
+    // True while a key reached by walking up from first still belongs to the range
+    bool contains(string_view key) const {
+        return prefix ? key.substr(0, first.size()) == first : key <= last;
+    }
+};
+
+/***************************************************************
+ * readPrefixQuery
+ *
+ * Prompts for a courseNumber prefix such as MATH or CSCI2* (a trailing * is optional).
+ ***************************************************************/
+CourseKeyRange readPrefixQuery() {
+    bufferedOut << "Which courses do you want to list (a prefix such as MATH or CSCI2*)? ";
+    bufferedOut.flush();
+    string userInput;
+    readUserLine(userInput);
+
+    CourseKeyRange range;
+    range.prefix = true;
+    range.first = toUpperTrim(userInput);
+    if (!range.first.empty() && range.first.back() == '*') {
+        range.first.pop_back();
+        toUpperTrimInPlace(range.first);
+    }
+    return range;
+}
+
+/***************************************************************
+ * readRangeQuery
+ *
+ * Prompts for the first and last courseNumbers of an inclusive range such as CSCI200 through CSCI299.
+ ***************************************************************/
+CourseKeyRange readRangeQuery() {
+    CourseKeyRange range;
+    string userInput;
+    bufferedOut << "First course number in the range? ";
+    bufferedOut.flush();
+    readUserLine(userInput);
+    range.first = toUpperTrim(userInput);
+    bufferedOut << "Last course number in the range? ";
+    bufferedOut.flush();
+    readUserLine(userInput);
+    range.last = toUpperTrim(userInput);
+    return range;
+}
+
+/***************************************************************
+ * printCourseRange
+ *
+ * Prints every course in range, in sorted order, in the same format as printAll. The walk starts at the lower bound
+ * of range.first and stops at the first courseNumber outside the range, so it costs O(log n + k) for k courses listed.
+ ***************************************************************/
+void printCourseRange(const CourseBST& bst, const CourseKeyRange& range) {
+    size_t listed = 0;
+    for (auto it = bst.lowerBound(range.first); it != bst.end() && range.contains(it->courseNumber); ++it) {
+        it->printCourseBasic();
+        ++listed;
+    }
+    if (listed == 0) {
+        bufferedOut << "No courses found.\n";
+    }
+}
+
+/***************************************************************
+ * printCourseRange (snapshot)
+ *
+ * The same listing from a mapped snapshot, whose records are already in sorted order.
+ ***************************************************************/
+void printCourseRange(const CourseSnapshot& snapshot, const CourseKeyRange& range) {
+    size_t listed = 0;
+    for (size_t i = snapshot.lowerBound(range.first); i < snapshot.size() && range.contains(snapshot.courseNumber(i)); ++i) {
+        bufferedOut << snapshot.courseNumber(i) << ", " << snapshot.courseName(i) << '\n';
+        ++listed;
+    }
+    if (listed == 0) {
+        bufferedOut << "No courses found.\n";
+    }
+}
+
+/***************************************************************
+ * printTitleSearch
+ *
+ * Prompts for words from a course's number or title (typos allowed) and prints the best matches from the title index,
+ * best first. courseText(id) returns a course's number and title, from whichever catalog the index was built from.
+ ***************************************************************/
+template <typename CourseText>
+void printTitleSearch(TitleIndex& titles, CourseText courseText) {
+    bufferedOut << "What do you want to search course titles for? ";
+    bufferedOut.flush();
+    string userInput;
+    readUserLine(userInput);
+
+    const size_t maxResults = 10;
+    vector<TitleMatch> matches = titles.search(userInput, maxResults);
+    if (matches.empty()) {
+        bufferedOut << "No matching courses.\n";
+        return;
+    }
+    for (const TitleMatch& match : matches) {
+        pair<string_view, string_view> text = courseText(match.course);
+        bufferedOut << text.first << ", " << text.second << '\n';
+    }
+}
+
+/***************************************************************
+ * BatchFormat
+ *
+ * Output format of batch mode (see runBatch): tab-separated columns or one JSON object per line.
+ ***************************************************************/
+enum class BatchFormat {
+    Tsv,
+    Jsonl
+};
+
+/***************************************************************
+ * CourseAnswer Struct
+ *
+ * The answer to one course lookup, as views into the tree or snapshot that answered it.
+ * A prerequisite that isn't in the catalog has inCatalog = false and an empty name.
+ * Reused from one query to the next so the vector keeps its capacity.
+ ***************************************************************/
+struct CourseAnswer {
+    struct Prerequisite {
+        string_view courseNumber;
+        string_view courseName;
+        bool inCatalog;
+    };
+
+    bool found = false;
+    string_view courseNumber;
+    string_view courseName;
+    vector<Prerequisite> prerequisites;
+};
+
+/***************************************************************
+ * fillAnswer
+ *
+ * Fills answer with what printCourseInfo would show for course (nullptr when it wasn't found),
+ * following the prerequisite links of a resolved tree, or looking each prerequisite up in prerequisiteIndex if given.
+ ***************************************************************/
+void fillAnswer(const Course* course, CourseAnswer& answer, const CourseIndex* prerequisiteIndex = nullptr) {
+    answer.prerequisites.clear();
+    answer.found = course != nullptr;
+    if (!course) return;
+
+    answer.courseNumber = course->courseNumber;
+    answer.courseName = course->courseName;
+    for (size_t i = 0; i < course->prerequisites.size(); ++i) {
+        const Course* target = prerequisiteIndex ? prerequisiteIndex->find(course->prerequisites[i]) : course->prerequisiteLinks[i];
+        answer.prerequisites.push_back({ course->prerequisites[i],
+            target ? string_view(target->courseName) : string_view(), target != nullptr });
+    }
+}
+
+/***************************************************************
+ * answerQuery
+ *
+ * Looks up courseKey (already upper-cased and trimmed) in the tree and fills answer with what printCourseInfo would show.
+ * The tree must have been resolved.
+ ***************************************************************/
+void answerQuery(const CourseBST& bst, const string& courseKey, CourseAnswer& answer) {
+    fillAnswer(bst.search(courseKey), answer);
+}
+
+/***************************************************************
+ * answerQuery (backend)
+ *
+ * The same lookup answered through one of the CourseIndex backends built over a resolved tree.
+ ***************************************************************/
+void answerQuery(const CourseIndex& index, const string& courseKey, CourseAnswer& answer) {
+    fillAnswer(index.find(courseKey), answer);
+}
+
+/***************************************************************
+ * answerQuery (snapshot or frozen catalog)
+ *
+ * The same lookup answered from a mapped CourseSnapshot or a FrozenCatalog, which number their courses the same way.
+ ***************************************************************/
+template <typename FlatCatalog>
+void answerQuery(const FlatCatalog& catalog, const string& courseKey, CourseAnswer& answer) {
+    answer.prerequisites.clear();
+    uint32_t course = catalog.find(courseKey);
+    answer.found = course != FlatCatalog::noTarget;
+    if (!answer.found) return;
+
+    answer.courseNumber = catalog.courseNumber(course);
+    answer.courseName = catalog.courseName(course);
+    for (size_t k = 0; k < catalog.prerequisiteCount(course); ++k) {
+        uint32_t target = catalog.prerequisiteTarget(course, k);
+        bool inCatalog = target != FlatCatalog::noTarget;
+        answer.prerequisites.push_back({ catalog.prerequisiteId(course, k),
+            inCatalog ? catalog.courseName(target) : string_view(), inCatalog });
+    }
+}
+
+/***************************************************************
+ * writeTsvField
+ *
+ * Writes text as one TSV column; tabs and line breaks inside it become spaces so the row keeps its shape.
+ * Output is an OutputBuffer or a StringOutput, as for the other writers below.
+ ***************************************************************/
+template <typename Output>
+void writeTsvField(Output& out, string_view text) {
+    for (char c : text) {
+        out << (c == '\t' || c == '\n' || c == '\r' ? ' ' : c);
+    }
+}
+
+/***************************************************************
+ * writeJsonString
+ *
+ * Writes text as a quoted JSON string, escaping quotes, backslashes and control characters.
+ ***************************************************************/
+template <typename Output>
+void writeJsonString(Output& out, string_view text) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out << '"';
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (byte < 0x20) {
+            out << "\\u00" << hexDigits[byte >> 4] << hexDigits[byte & 0xf];
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+/***************************************************************
+ * writeAnswer
+ *
+ * Writes one answer as a single line. TSV rows are
+ *    ok <TAB> courseNumber <TAB> courseName [<TAB> prereqNumber <TAB> prereqName]...
+ *    not_found <TAB> query
+ * with an empty name for a prerequisite that isn't in the catalog. JSON lines are
+ *    {"query":"CSCI300","found":true,"courseNumber":"CSCI300","courseName":"...",
+ *     "prerequisites":[{"courseNumber":"CSCI200","courseName":"..."},{"courseNumber":"X","courseName":null}]}
+ *    {"query":"CSCI999","found":false}
+ ***************************************************************/
+template <typename Output>
+void writeAnswer(Output& out, const string& courseKey, const CourseAnswer& answer, BatchFormat format) {
+    if (format == BatchFormat::Tsv) {
+        if (!answer.found) {
+            out << "not_found\t";
+            writeTsvField(out, courseKey);
+            out << '\n';
+            return;
+        }
+        out << "ok\t";
+        writeTsvField(out, answer.courseNumber);
+        out << '\t';
+        writeTsvField(out, answer.courseName);
+        for (const auto& prerequisite : answer.prerequisites) {
+            out << '\t';
+            writeTsvField(out, prerequisite.courseNumber);
+            out << '\t';
+            writeTsvField(out, prerequisite.courseName);
+        }
+        out << '\n';
+        return;
+    }
+
+    out << "{\"query\":";
+    writeJsonString(out, courseKey);
+    if (!answer.found) {
+        out << ",\"found\":false}\n";
+        return;
+    }
+    out << ",\"found\":true,\"courseNumber\":";
+    writeJsonString(out, answer.courseNumber);
+    out << ",\"courseName\":";
+    writeJsonString(out, answer.courseName);
+    out << ",\"prerequisites\":[";
+    for (size_t i = 0; i < answer.prerequisites.size(); ++i) {
+        const auto& prerequisite = answer.prerequisites[i];
+        if (i) out << ',';
+        out << "{\"courseNumber\":";
+        writeJsonString(out, prerequisite.courseNumber);
+        out << ",\"courseName\":";
+        if (prerequisite.inCatalog) {
+            writeJsonString(out, prerequisite.courseName);
+        }
+        else {
+            out << "null";
+        }
+        out << '}';
+    }
+    out << "]}\n";
+}
+
+/***************************************************************
+ * ValidationMode
+ *
+ * What batch and server mode do about validating the catalog they load (see --validate):
+ *   - Off: nothing beyond the load's own warnings
+ *   - Report: validate the catalog and print the report (see printCatalogReport), then use it anyway
+ *   - Strict: as Report, but a catalog with any problem is rejected: batch mode exits, and a server keeps serving
+ *     the version it has
+ ***************************************************************/
+enum class ValidationMode {
+    Off,
+    Report,
+    Strict
+};
+
+/***************************************************************
+ * QueryCatalog Struct
+ *
+ * A catalog loaded only to answer lookups: mapped from its snapshot when that is still valid, otherwise parsed into a
+ * tree (and a fresh snapshot written). Batch mode uses one; server mode treats each one as an immutable version of the
+ * catalog and swaps in a new one on every reload, except that a skiplist catalog is updated in place (see reloadInPlace).
+ * Given a backend name (see makeCourseIndex), the catalog always ends up in the tree (a valid snapshot still saves
+ * the parse) and lookups go through that backend instead.
+ * A validated load always parses the CSV, since the snapshot doesn't record the rows its load skipped.
+ * Its strings are interned in a StringPool of its own, so destroying the catalog frees them too.
+ ***************************************************************/
+struct QueryCatalog {
+    // Declared first so it is destroyed last, after everything holding its strings
+    unique_ptr<StringPool> strings;
+    CourseBST bst;
+    CourseSnapshot snapshot;
+    bool fromSnapshot = false;
+    // The selected backend over bst's courses, if any
+    unique_ptr<CourseIndex> index;
+    // The same index when it is a skiplist, which reloadInPlace updates while answer() runs
+    ConcurrentCourseIndex* liveIndex = nullptr;
+    // Courses reloadInPlace added or changed (bst keeps owning the ones first loaded, even once they are replaced)
+    unordered_map<const Course*, unique_ptr<Course>> ingested;
+    // The catalog compacted by --backend frozen, which then replaces the tree
+    FrozenCatalog frozen;
+    bool isFrozen = false;
+    // Server mode numbers the catalogs it serves, so cached responses can tell which one they came from;
+    // an in-place reload changes it while workers read it
+    atomic<uint64_t> version{ 0 };
+
+    /***************************************************************
+     * Retired Struct
+     *
+     * What a reloadInPlace took out of the catalog: the index nodes and the courses readers may still be using.
+     * Destroying it frees them, so the caller keeps it until no reader that started before the reload is left.
+     ***************************************************************/
+    struct Retired {
+        ConcurrentCourseIndex::RetiredNodes nodes;
+        vector<unique_ptr<Course>> courses;
+    };
+
+    // Loads csvFile, printing progress and warnings to cout; returns false if it couldn't be loaded (or was rejected
+    // by strict validation). backend names a CourseIndex to answer through, "frozen" for a FrozenCatalog,
+    // or is empty for the default lookups.
+    bool load(const string& csvFile, const string& backend = string(), ValidationMode validation = ValidationMode::Off) {
+        strings = make_unique<StringPool>();
+        bool loaded;
+        {
+            StringPool::Scope scope(*strings);
+            loaded = loadInPool(csvFile, backend, validation);
+        }
+        // The frozen copy holds its own text, so the pooled strings go with the tree
+        if (isFrozen) strings.reset();
+        return loaded;
+    }
+
+    // Number of courses the catalog answers for
+    size_t courseCount() const {
+        if (isFrozen) return frozen.size();
+        if (index) return index->size();
+        return fromSnapshot ? snapshot.size() : bst.size();
+    }
+
+    // Only reads the catalog, so any number of threads may call it at once
+    void answer(const string& courseKey, CourseAnswer& result) const {
+        if (isFrozen) {
+            answerQuery(frozen, courseKey, result);
+        }
+        else if (liveIndex) {
+            // A reload may replace any course, so links to other courses can't be trusted; prerequisites are looked up
+            fillAnswer(liveIndex->find(courseKey), result, liveIndex);
+        }
+        else if (index) {
+            answerQuery(*index, courseKey, result);
+        }
+        else if (fromSnapshot) {
+            answerQuery(snapshot, courseKey, result);
+        }
+        else {
+            answerQuery(bst, courseKey, result);
+        }
+    }
+
+    // Parses csvFile for reloadInPlace, interning its strings in this catalog's pool; returns false if it can't be read
+    bool parseForReload(const string& csvFile, vector<Course>& courses) {
+        StringPool::Scope scope(*strings);
+        return parseCourseFile(csvFile, courses, 0);
+    }
+
+    // Applies a parsed catalog to the live skiplist index while other threads keep calling answer(): courses that are
+    // new are inserted, those whose row changed are replaced by the new parse, and those no longer in the file are
+    // erased. Only one reload may run at a time. What it takes out goes into retired; the caller bumps the version.
+    void reloadInPlace(vector<Course>&& courses, Retired& retired) {
+        size_t added = 0;
+        size_t updated = 0;
+        size_t unchanged = 0;
+        // The views point into the pool, so they outlive the moves below
+        unordered_set<string_view> listed;
+        for (Course& course : courses) {
+            if (!listed.insert(course.courseNumber).second) {
+                cout << "WARNING: Duplicate course (skipped): " << course.courseNumber << endl;
+                continue;
+            }
+            const Course* existing = liveIndex->find(course.courseNumber);
+            // Same bytes as last time => nothing to do
+            if (existing && existing->rowHash == course.rowHash) {
+                ++unchanged;
+                continue;
+            }
+            unique_ptr<Course> owned(new Course(move(course)));
+            const Course* fresh = owned.get();
+            ingested.emplace(fresh, move(owned));
+            if (existing) {
+                retire(liveIndex->replace(fresh), retired);
+                ++updated;
+            }
+            else {
+                liveIndex->insert(fresh);
+                ++added;
+            }
+        }
+
+        // Courses whose row disappeared
+        vector<string_view> removed;
+        liveIndex->forEach([&](const Course& course) {
+            if (!listed.count(course.courseNumber)) removed.push_back(course.courseNumber);
+        });
+        for (string_view courseNumber : removed) {
+            retire(liveIndex->erase(courseNumber), retired);
+        }
+        retired.nodes = liveIndex->takeRetired();
+        cout << "Catalog updated in place: " << added << " added, " << updated << " updated, "
+            << removed.size() << " removed, " << unchanged << " unchanged." << endl;
+    }
+
+private:
+    // Hands a course taken out of the index to retired, if a reload added it; bst's own courses stay where they are
+    void retire(const Course* course, Retired& retired) {
+        auto owner = ingested.find(course);
+        if (owner == ingested.end()) return;
+        retired.courses.push_back(move(owner->second));
+        ingested.erase(owner);
+    }
+
+    // The body of load, run with this catalog's pool active
+    bool loadInPool(const string& csvFile, const string& backend, ValidationMode validation) {
+        // A streamed feed can't be read a second time to validate a snapshot, so it always loads into the tree
+        bool streamed = isStreamSource(csvFile);
+        bool validated = validation != ValidationMode::Off;
+        string snapshotProblem;
+        fromSnapshot = !streamed && !validated && snapshot.open(csvFile, snapshotProblem);
+        if (!fromSnapshot) {
+            CatalogReport report;
+            if (!loadCourses(csvFile, bst, LoadMode::Parallel, validated ? &report : nullptr)) return false;
+            if (validated) {
+                printCatalogReport(report);
+                // Rejected before a snapshot is written or a backend is built
+                if (validation == ValidationMode::Strict && !report.clean()) {
+                    cout << "ERROR: " << csvFile << " failed validation; the catalog was rejected." << endl;
+                    return false;
+                }
+            }
+            if (!streamed && !CourseSnapshot::write(bst, csvFile)) {
+                cout << "WARNING: Could not write snapshot " << CourseSnapshot::pathFor(csvFile) << endl;
+            }
+        }
+        if (backend.empty()) return true;
+
+        if (fromSnapshot) {
+            bst.bulkLoad(snapshot.toCourses());
+            bst.resolvePrerequisites();
+            snapshot.close();
+            fromSnapshot = false;
+        }
+        if (backend == frozenBackendName) {
+            isFrozen = frozen.freeze(bst);
+            if (!isFrozen) {
+                cout << "WARNING: Catalog too large to freeze; answering from the tree" << endl;
+                return true;
+            }
+            // The frozen copy holds everything a query reads
+            bst.clear();
+            return true;
+        }
+        vector<const Course*> sortedCourses;
+        sortedCourses.reserve(bst.size());
+        for (const Course& course : bst) sortedCourses.push_back(&course);
+        index = makeCourseIndex(backend);
+        index->build(sortedCourses);
+        liveIndex = dynamic_cast<ConcurrentCourseIndex*>(index.get());
+        return true;
+    }
+};
+
+/***************************************************************
+ * runBatch
+ *
+ * Non-interactive mode for scripts: loads csvFile (see QueryCatalog::load), then answers one course number per line
+ * of queries with one line of output each, through the named backend if one was given.
+ * Blank lines are skipped. No prompts are printed; load progress and warnings go to stderr so stdout carries only answers.
+ * validation says whether the catalog is validated first (see ValidationMode).
+ * Returns the process exit code: 0 on success, 1 if the catalog couldn't be loaded or failed strict validation.
+ ***************************************************************/
+int runBatch(const string& csvFile, istream& queries, BatchFormat format, const string& backend, ValidationMode validation) {
+    QueryCatalog catalog;
+
+    // Send everything the loaders print to stderr while loading
+    streambuf* savedOutput = cout.rdbuf(cerr.rdbuf());
+    bool loadedOk = catalog.load(csvFile, backend, validation);
+    cout.rdbuf(savedOutput);
+    if (!loadedOk) return 1;
+
+    CourseAnswer answer;
+    string line;
+    string courseKey;
+    while (getline(queries, line)) {
+        courseKey = line;
+        toUpperTrimInPlace(courseKey);
+        if (courseKey.empty()) continue;
+
+        catalog.answer(courseKey, answer);
+        writeAnswer(bufferedOut, courseKey, answer, format);
+    }
+    bufferedOut.flush();
+    return 0;
+}
+
+#ifndef _WIN32
+/***************************************************************
+ * EpochReclaimer Class
+ *
+ * Epoch-based reclamation for the catalog versions server mode swaps in. Each reader thread owns a slot: it publishes
+ * the current epoch there before it loads the catalog pointer, and clears it once it is done with that catalog.
+ * The writer swaps the pointer, then advances the epoch; the old catalog can be freed once every slot is either idle
+ * or holds the new epoch (or a later one), since those readers loaded the pointer after the swap.
+ * Readers never lock or wait; only the writer waits.
+ ***************************************************************/
+class EpochReclaimer {
+private:
+    // Slot value of a reader that holds no catalog
+    static constexpr uint64_t idle = 0;
+
+    // One cache line per slot, so readers don't slow each other down by sharing one
+    struct alignas(64) Slot {
+        atomic<uint64_t> epoch{ idle };
+    };
+
+    atomic<uint64_t> globalEpoch{ 1 };
+    unique_ptr<Slot[]> slots;
+    size_t slotCount;
+
+public:
+    explicit EpochReclaimer(size_t readers) : slots(new Slot[readers]), slotCount(readers) {}
+
+    // Reader side: bracket every use of a catalog pointer loaded in between
+    void enter(size_t reader) {
+        slots[reader].epoch.store(globalEpoch.load());
+    }
+
+    void leave(size_t reader) {
+        slots[reader].epoch.store(idle, memory_order_release);
+    }
+
+    // Writer side: call after swapping the pointer; returns the epoch to wait for
+    uint64_t advance() {
+        return globalEpoch.fetch_add(1) + 1;
+    }
+
+    // True once no reader can still hold a pointer retired before epoch began
+    bool quiescentSince(uint64_t epoch) const {
+        for (size_t i = 0; i < slotCount; ++i) {
+            uint64_t seen = slots[i].epoch.load();
+            if (seen != idle && seen < epoch) return false;
+        }
+        return true;
+    }
+};
+
+// Set by SIGHUP; the reloader thread picks it up (a lock-free atomic, so the handler may touch it from any thread)
+static atomic<bool> reloadSignalled(false);
+static_assert(atomic<bool>::is_always_lock_free, "the SIGHUP flag must be lock-free");
+
+extern "C" void onReloadSignal(int) {
+    reloadSignalled.store(true);
+}
+
+/***************************************************************
+ * makeNonBlockingAndCloseOnExec
+ *
+ * Switches a descriptor to non-blocking mode and marks it close-on-exec (so the gzip a .gz reload starts, see FeedReader,
+ * doesn't inherit it); for platforms where the socket calls can't set both flags themselves. Returns false on failure.
+ ***************************************************************/
+bool makeNonBlockingAndCloseOnExec(int descriptor) {
+    int flags = fcntl(descriptor, F_GETFL);
+    return flags >= 0 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0 && fcntl(descriptor, F_SETFD, FD_CLOEXEC) == 0;
+}
+
+/***************************************************************
+ * CatalogServer Class
+ *
+ * Long-running lookup service over TCP. Clients send one course number per line and get one answer line back
+ * (the same TSV or JSON lines as batch mode). Three commands are recognized: "!reload" (reloads the catalog in the
+ * background and replies "reloading"), "!stats" (replies with the catalog version and the response caches' hit and
+ * miss counts, tab-separated) and "!quit" (closes the connection). SIGHUP also triggers a reload.
+ *
+ * One event loop (the thread that called run) owns every socket: it polls the listener and all connections, accepts,
+ * reads and sends without blocking, and hands each connection's complete lines to a fixed pool of worker threads as one
+ * job. A connection has at most one job at a time, so its answers come back in order; a worker answers the job's lines,
+ * queues the text for the loop and wakes it through a pipe. Workers never touch a socket, so idle or slow clients cost a
+ * descriptor and a little memory but never hold a worker: any number of connections can be open, and a line is answered
+ * as soon as a worker is free. A connection whose unsent answers or unanswered input reach maxPendingBytes isn't read
+ * until it catches up; one that sends a line longer than maxLineBytes is closed once its earlier lines are answered.
+ *
+ * Workers read the catalog through an atomically swapped pointer to an immutable QueryCatalog and never take a lock
+ * to do so. A reload builds the next QueryCatalog on its own thread, swaps it in, and frees the old one once the
+ * EpochReclaimer shows no worker can still be reading it, so lookups keep being answered from the old version until
+ * the new one is ready. With the skiplist backend and no validation, a reload instead updates the live catalog's index
+ * in place while workers search it (see QueryCatalog::reloadInPlace), and the courses and nodes it takes out are freed
+ * the same way. A version with no courses, or one that fails strict validation, is never served: the server
+ * keeps the version it has (or, for the first load, doesn't start). Since every reload reads the catalog again, the
+ * server refuses to start on standard input or a pipe.
+ * Each worker also keeps its own ResponseCache of answer lines, which it drops when it sees a new catalog version.
+ ***************************************************************/
+class CatalogServer {
+public:
+    CatalogServer(string csvFile, BatchFormat format, size_t workerCount, size_t cacheEntries, string backend,
+        ValidationMode validation)
+        : csvFile(move(csvFile)), backend(move(backend)), validation(validation), format(format), workerCount(workerCount),
+        cacheEntries(cacheEntries),
+        epochs(workerCount), stats(new WorkerStats[workerCount]),
+        current(nullptr), stopping(false), wakeRead(-1), wakeWrite(-1), reloadRequested(false), version(0) {}
+
+    ~CatalogServer() {
+        delete current.load();
+    }
+
+    // Loads the catalog, then serves port until the process is stopped. Returns 1 if it can't load or listen.
+    int run(uint16_t port) {
+        // Load output goes to stderr, as in batch mode
+        cout.rdbuf(cerr.rdbuf());
+        if (!isRereadableSource(csvFile)) {
+            cerr << "ERROR: Server mode rereads its catalog on every reload, so it needs a file, not standard input or a pipe"
+                << endl;
+            return 1;
+        }
+        unique_ptr<QueryCatalog> first(new QueryCatalog);
+        if (!first->load(csvFile, backend, validation)) return 1;
+        if (first->courseCount() == 0) {
+            cerr << "ERROR: " << csvFile << " holds no courses; nothing to serve" << endl;
+            return 1;
+        }
+        version = first->version = 1;
+        current.store(first.release());
+
+        // Every server descriptor is non-blocking (the loop must never wait on one client) and close-on-exec
+        int wakePipe[2];
+#if defined(__linux__)
+        int listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        bool piped = ::pipe2(wakePipe, O_NONBLOCK | O_CLOEXEC) == 0;
+#else
+        int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listener >= 0 && !makeNonBlockingAndCloseOnExec(listener)) {
+            ::close(listener);
+            listener = -1;
+        }
+        bool piped = ::pipe(wakePipe) == 0;
+        if (piped && (!makeNonBlockingAndCloseOnExec(wakePipe[0]) || !makeNonBlockingAndCloseOnExec(wakePipe[1]))) {
+            ::close(wakePipe[0]);
+            ::close(wakePipe[1]);
+            piped = false;
+        }
+#endif
+        if (listener < 0 || !piped) {
+            cerr << "ERROR: Could not create a socket" << endl;
+            if (listener >= 0) ::close(listener);
+            if (piped) {
+                ::close(wakePipe[0]);
+                ::close(wakePipe[1]);
+            }
+            return 1;
+        }
+        wakeRead = wakePipe[0];
+        wakeWrite = wakePipe[1];
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listener, 128) < 0) {
+            cerr << "ERROR: Could not listen on port " << port << endl;
+            ::close(listener);
+            ::close(wakeRead);
+            ::close(wakeWrite);
+            return 1;
+        }
+
+        // A client that disconnects mid-answer must not kill the server
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGHUP, onReloadSignal);
+
+        vector<thread> threads;
+        for (size_t i = 0; i < workerCount; ++i) {
+            threads.emplace_back([this, i] { workerLoop(i); });
+        }
+        thread reloader([this] { reloaderLoop(); });
+        cerr << "Serving " << csvFile << " on port " << port << " with " << workerCount << " worker threads." << endl;
+
+        eventLoop(listener);
+
+        // Only reached if polling or accepting fails for good: let the workers finish their jobs, then stop
+        ::close(listener);
+        {
+            lock_guard<mutex> guard(queueLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        {
+            lock_guard<mutex> guard(reloadLock);
+            reloadWanted.notify_all();
+        }
+        for (auto& worker : threads) worker.join();
+        reloader.join();
+        for (auto& entry : connections) ::close(entry.second.socket);
+        ::close(wakeRead);
+        ::close(wakeWrite);
+        return 1;
+    }
+
+private:
+    // Longest request line accepted; a client sending more without a newline is disconnected
+    static constexpr size_t maxLineBytes = 4096;
+    // A connection isn't read while this much of its input waits to be answered, or of its answers waits to be sent
+    static constexpr size_t maxPendingBytes = 1 << 20;
+    // Most input handed to a worker as one job, so one busy client can't keep a worker for long
+    static constexpr size_t maxJobBytes = 64 * 1024;
+
+    string csvFile;
+    // CourseIndex backend every catalog version is queried through (empty for the default lookups)
+    string backend;
+    // Whether each version is validated first, and whether a failing one is refused (see ValidationMode)
+    ValidationMode validation;
+    BatchFormat format;
+    size_t workerCount;
+    size_t cacheEntries;
+    EpochReclaimer epochs;
+
+    // Each worker's cache counters, written only by that worker and summed by !stats
+    struct alignas(64) WorkerStats {
+        atomic<size_t> hits{ 0 };
+        atomic<size_t> misses{ 0 };
+    };
+    unique_ptr<WorkerStats[]> stats;
+
+    // The catalog version readers see; only the reloader replaces it
+    atomic<QueryCatalog*> current;
+
+    // One client, owned by the event loop
+    struct Connection {
+        int socket;
+        // Input not yet handed to a worker (complete lines, then at most one partial one)
+        string received;
+        // Answers the socket hasn't accepted yet
+        string unsent;
+        // A worker is answering a job of this connection's lines
+        bool busy = false;
+        // Nothing more will be read (the client finished sending, sent !quit, or sent an overlong line):
+        // the connection closes once its last job is answered and sent
+        bool readDone = false;
+        // The socket failed (the client went away): the connection closes as soon as no worker holds a job for it
+        bool failed = false;
+    };
+    // Connections by id (ids are never reused, unlike descriptors, so a late answer can't reach the wrong client)
+    unordered_map<uint64_t, Connection> connections;
+
+    // A batch of one connection's complete lines, and a worker's answers to it
+    struct Job {
+        uint64_t connection;
+        string lines;
+    };
+    struct Answered {
+        uint64_t connection;
+        string answers;
+        // The client sent !quit: the lines after it were not answered
+        bool quit;
+    };
+
+    // Jobs waiting for a free worker
+    mutex queueLock;
+    condition_variable jobReady;
+    deque<Job> jobs;
+    bool stopping;
+
+    // Finished jobs waiting for the loop, which a worker wakes by writing a byte to wakeWrite
+    mutex answeredLock;
+    vector<Answered> answered;
+    int wakeRead;
+    int wakeWrite;
+
+    // Reload requests from clients
+    mutex reloadLock;
+    condition_variable reloadWanted;
+    bool reloadRequested;
+    // Number of catalogs loaded so far (only the reloader touches it after run() starts the threads)
+    uint64_t version;
+
+    // Polls the listener, the wake pipe and every connection, and moves bytes and jobs between them.
+    // Returns only if poll or accept fails for a reason other than a signal or a client giving up mid-handshake.
+    void eventLoop(int listener) {
+        uint64_t nextId = 1;
+        vector<pollfd> polled;
+        vector<uint64_t> polledIds;
+        vector<Answered> finished;
+        for (;;) {
+            polled.clear();
+            polledIds.clear();
+            polled.push_back({ listener, POLLIN, 0 });
+            polled.push_back({ wakeRead, POLLIN, 0 });
+            for (auto& [id, connection] : connections) {
+                short events = 0;
+                if (!connection.readDone && !connection.failed && connection.received.size() < maxPendingBytes
+                    && connection.unsent.size() < maxPendingBytes) events |= POLLIN;
+                if (!connection.unsent.empty() && !connection.failed) events |= POLLOUT;
+                // A negative descriptor is skipped, so a hung-up client waiting on its job can't keep waking the loop
+                polled.push_back({ events ? connection.socket : -1, events, 0 });
+                polledIds.push_back(id);
+            }
+
+            if (::poll(polled.data(), static_cast<nfds_t>(polled.size()), -1) < 0) {
+                if (errno == EINTR) continue;
+                cerr << "ERROR: poll failed" << endl;
+                return;
+            }
+
+            // Answers from the workers
+            if (polled[1].revents) {
+                char drained[256];
+                while (::read(wakeRead, drained, sizeof(drained)) > 0) {}
+                {
+                    lock_guard<mutex> guard(answeredLock);
+                    finished.swap(answered);
+                }
+                for (Answered& done : finished) {
+                    Connection& connection = connections.at(done.connection);
+                    connection.busy = false;
+                    connection.unsent += done.answers;
+                    if (done.quit) {
+                        connection.readDone = true;
+                        connection.received.clear();
+                    }
+                    sendPending(connection);
+                    dispatch(done.connection, connection);
+                }
+                finished.clear();
+            }
+
+            for (size_t i = 2; i < polled.size(); ++i) {
+                if (!polled[i].revents) continue;
+                uint64_t id = polledIds[i - 2];
+                Connection& connection = connections.at(id);
+                if ((polled[i].revents & (POLLIN | POLLHUP | POLLERR)) && !connection.readDone) receive(connection);
+                if (polled[i].revents & POLLOUT) sendPending(connection);
+                dispatch(id, connection);
+            }
+
+            // Close what is finished: failed connections once no worker holds their job, others once everything is sent
+            for (auto it = connections.begin(); it != connections.end();) {
+                const Connection& connection = it->second;
+                if (!connection.busy && (connection.failed || (connection.readDone && connection.unsent.empty()))) {
+                    ::close(connection.socket);
+                    it = connections.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+
+            if (polled[0].revents & POLLIN) {
+                for (;;) {
+#if defined(__linux__)
+                    int socket = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+                    int socket = ::accept(listener, nullptr, nullptr);
+                    if (socket >= 0 && !makeNonBlockingAndCloseOnExec(socket)) {
+                        ::close(socket);
+                        continue;
+                    }
+#endif
+                    if (socket >= 0) {
+                        connections[nextId++].socket = socket;
+                        continue;
+                    }
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    if (errno == EINTR || errno == ECONNABORTED) continue;
+                    cerr << "ERROR: accept failed" << endl;
+                    return;
+                }
+            }
+        }
+    }
+
+    // Reads what the socket has (up to maxPendingBytes buffered); the end of input or an error stops reading
+    void receive(Connection& connection) {
+        char chunk[16384];
+        while (connection.received.size() < maxPendingBytes) {
+            ssize_t got = ::recv(connection.socket, chunk, sizeof(chunk), 0);
+            if (got > 0) {
+                connection.received.append(chunk, static_cast<size_t>(got));
+                continue;
+            }
+            if (got == 0) connection.readDone = true;
+            else if (errno == EINTR) continue;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK) connection.failed = true;
+            return;
+        }
+    }
+
+    // Sends as much of the unsent answers as the socket takes without blocking
+    void sendPending(Connection& connection) {
+        size_t sent = 0;
+        while (!connection.failed && sent < connection.unsent.size()) {
+            ssize_t got = ::send(connection.socket, connection.unsent.data() + sent, connection.unsent.size() - sent, 0);
+            if (got > 0) {
+                sent += static_cast<size_t>(got);
+            }
+            else if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            else {
+                if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) connection.failed = true;
+                break;
+            }
+        }
+        connection.unsent.erase(0, sent);
+    }
+
+    // Hands the connection's next complete lines (up to maxJobBytes) to a worker, unless it already has a job
+    void dispatch(uint64_t id, Connection& connection) {
+        if (connection.busy || connection.failed) return;
+        size_t lastNewline = connection.received.rfind('\n', maxJobBytes - 1);
+        if (lastNewline == string::npos) {
+            // A line that never ends: stop reading, and close once the answers before it are sent
+            if (connection.received.size() > maxLineBytes) {
+                connection.readDone = true;
+                connection.received.clear();
+            }
+            return;
+        }
+        Job job{ id, connection.received.substr(0, lastNewline + 1) };
+        connection.received.erase(0, lastNewline + 1);
+        connection.busy = true;
+        {
+            lock_guard<mutex> guard(queueLock);
+            jobs.push_back(move(job));
+        }
+        jobReady.notify_one();
+    }
+
+    void workerLoop(size_t reader) {
+        // Kept across jobs; cachedVersion is the catalog its entries came from
+        ResponseCache cache(cacheEntries);
+        uint64_t cachedVersion = 0;
+        for (;;) {
+            Job job;
+            {
+                unique_lock<mutex> guard(queueLock);
+                jobReady.wait(guard, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = move(jobs.front());
+                jobs.pop_front();
+            }
+            Answered done{ job.connection, string(), false };
+            done.quit = answerLines(job.lines, reader, cache, cachedVersion, done.answers);
+            {
+                lock_guard<mutex> guard(answeredLock);
+                answered.push_back(move(done));
+            }
+            // A full pipe already holds a wake-up, so a failed write loses nothing
+            char wake = 1;
+            ssize_t written = ::write(wakeWrite, &wake, 1);
+            (void)written;
+        }
+    }
+
+    // Answers each line of lines into answers; returns true (leaving the rest unanswered) at a !quit
+    bool answerLines(const string& lines, size_t reader, ResponseCache& cache, uint64_t& cachedVersion, string& answers) {
+        StringOutput out{ answers };
+        CourseAnswer answer;
+        string response;
+        string courseKey;
+        size_t start = 0;
+        size_t newline;
+        while ((newline = lines.find('\n', start)) != string::npos) {
+            courseKey.assign(lines, start, newline - start);
+            start = newline + 1;
+            toUpperTrimInPlace(courseKey);
+            if (courseKey.empty()) continue;
+
+            if (courseKey == "!QUIT") return true;
+            if (courseKey == "!RELOAD") {
+                requestReload();
+                out << "reloading\n";
+                continue;
+            }
+            if (courseKey == "!STATS") {
+                writeStats(out, reader);
+                continue;
+            }
+
+            // The catalog and the views in answer stay valid until leave(); the reply is text of our own
+            epochs.enter(reader);
+            const QueryCatalog* catalog = current.load();
+            if (catalog->version != cachedVersion) {
+                cache.clear();
+                cachedVersion = catalog->version;
+            }
+            const string* reply = cache.find(courseKey);
+            if (!reply) {
+                response.clear();
+                catalog->answer(courseKey, answer);
+                StringOutput line{ response };
+                writeAnswer(line, courseKey, answer, format);
+                cache.store(courseKey, response);
+                reply = &response;
+            }
+            epochs.leave(reader);
+            out << *reply;
+            stats[reader].hits.store(cache.hits(), memory_order_relaxed);
+            stats[reader].misses.store(cache.misses(), memory_order_relaxed);
+        }
+        return false;
+    }
+
+    // Replies to !stats: catalog_version, cache_hits and cache_misses, each followed by its value
+    void writeStats(StringOutput& out, size_t reader) {
+        size_t hits = 0;
+        size_t misses = 0;
+        for (size_t i = 0; i < workerCount; ++i) {
+            hits += stats[i].hits.load(memory_order_relaxed);
+            misses += stats[i].misses.load(memory_order_relaxed);
+        }
+        epochs.enter(reader);
+        uint64_t serving = current.load()->version;
+        epochs.leave(reader);
+        out << "catalog_version\t" << serving << "\tcache_hits\t" << hits << "\tcache_misses\t" << misses << '\n';
+    }
+
+    void requestReload() {
+        lock_guard<mutex> guard(reloadLock);
+        reloadRequested = true;
+        reloadWanted.notify_one();
+    }
+
+    // Waits for reload requests (or SIGHUP), builds each new catalog and publishes it
+    void reloaderLoop() {
+        for (;;) {
+            {
+                unique_lock<mutex> guard(reloadLock);
+                // Wakes up now and then to notice SIGHUP, which can't signal the condition variable itself
+                reloadWanted.wait_for(guard, chrono::milliseconds(200),
+                    [this] { return reloadRequested || reloadSignalled || stoppingNow(); });
+                if (stoppingNow()) return;
+                if (!reloadRequested && !reloadSignalled) continue;
+                reloadRequested = false;
+                reloadSignalled.store(false);
+            }
+
+            // Only this thread changes current, so the catalog can't go away under it
+            QueryCatalog* live = current.load();
+            if (live->liveIndex && validation == ValidationMode::Off) {
+                vector<Course> courses;
+                if (!live->parseForReload(csvFile, courses)) {
+                    cerr << "WARNING: Reload failed; still serving catalog version " << version << endl;
+                    continue;
+                }
+                if (courses.empty()) {
+                    cerr << "WARNING: Reload found no courses; still serving catalog version " << version << endl;
+                    continue;
+                }
+                QueryCatalog::Retired retired;
+                live->reloadInPlace(move(courses), retired);
+                live->version = ++version;
+                cerr << "Now serving catalog version " << version << "." << endl;
+                waitForReaders();
+                continue;
+            }
+
+            unique_ptr<QueryCatalog> fresh(new QueryCatalog);
+            if (!fresh->load(csvFile, backend, validation)) {
+                cerr << "WARNING: Reload failed; still serving catalog version " << version << endl;
+                continue;
+            }
+            // A truncated or emptied feed would otherwise answer "not found" for every course
+            if (fresh->courseCount() == 0) {
+                cerr << "WARNING: Reload found no courses; still serving catalog version " << version << endl;
+                continue;
+            }
+            fresh->version = ++version;
+            QueryCatalog* retired = current.exchange(fresh.release());
+            cerr << "Now serving catalog version " << version << "." << endl;
+
+            // Free the old version once no worker can still be reading it
+            waitForReaders();
+            delete retired;
+        }
+    }
+
+    // Returns once every worker that was reading the catalog when it was called has stopped
+    void waitForReaders() {
+        uint64_t epoch = epochs.advance();
+        while (!epochs.quiescentSince(epoch)) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+
+    bool stoppingNow() {
+        lock_guard<mutex> guard(queueLock);
+        return stopping;
+    }
+};
+#endif
+
+/***************************************************************
+ * runServer
+ *
+ * Server mode (see CatalogServer): serves csvFile on port with workerCount worker threads, each caching up to
+ * cacheEntries responses and answering through the named backend (if any), until the process is stopped.
+ * validation applies to the first catalog and every reload (see ValidationMode). Returns the process exit code.
+ ***************************************************************/
+int runServer(const string& csvFile, uint16_t port, size_t workerCount, BatchFormat format, size_t cacheEntries,
+    const string& backend, ValidationMode validation) {
+#ifdef _WIN32
+    (void)csvFile; (void)port; (void)workerCount; (void)format; (void)cacheEntries; (void)backend; (void)validation;
+    cerr << "ERROR: Server mode is only available on POSIX systems" << endl;
+    return 1;
+#else
+    CatalogServer server(csvFile, format, workerCount, cacheEntries, backend, validation);
+    return server.run(port);
+#endif
+}
+
+/***************************************************************
+ * runStressTest
+ *
+ * Self-check for the skiplist backend, ConcurrentCourseIndex (what --stress runs): threadCount threads share courseCount synthetic courses,
+ * half of them inserting and half searching at the same time. A quarter of the course numbers share their first
+ * eight bytes, so the string comparison behind the packed keys is exercised too. Every course is inserted by two
+ * writers racing each other. The run checks that:
+ *   - exactly one insert of each courseNumber returns true;
+ *   - a search that starts after an insert has returned finds that course (real-time order);
+ *   - a course a reader has found is found again on every later search (no course ever disappears);
+ *   - a search only ever returns the course it asked for;
+ *   - afterwards the index holds every course once, in sorted order.
+ * It then times lookups on 1, 2, 4, ... threads to show how read throughput scales. Last, the writers erase every
+ * odd-numbered course (two racing for each) and replace every even-numbered one while the readers search, checking that:
+ *   - exactly one erase of each erased courseNumber returns its course;
+ *   - a search that starts after an erase has returned no longer finds that course;
+ *   - a course that is only replaced is never missing, and a search returns either its old or its new course;
+ *   - afterwards the index holds just the replacements, in sorted order, and every erased node was unlinked.
+ * Returns the process exit code: 0 if every check passed, 1 otherwise.
+ ***************************************************************/
+int runStressTest(size_t courseCount, size_t threadCount) {
+    size_t writerCount = max<size_t>(1, threadCount / 2);
+    size_t readerCount = max<size_t>(1, threadCount - writerCount);
+    cout << "Stress test: " << courseCount << " courses, " << writerCount << " writer and "
+        << readerCount << " reader threads" << endl;
+
+    vector<string> numbers(courseCount);
+    for (size_t i = 0; i < courseCount; ++i) {
+        char text[32];
+        snprintf(text, sizeof(text), i % 4 == 0 ? "LONGPREFIX%07zu" : "DP%06zu", i);
+        numbers[i] = text;
+    }
+    auto expectedName = [&](string_view courseNumber) {
+        return "Course " + string(courseNumber);
+    };
+
+    // Writer w inserts, in a shuffled order, its own share of the courses and then its neighbor's share
+    vector<size_t> order(courseCount);
+    for (size_t i = 0; i < courseCount; ++i) order[i] = i;
+    uint64_t shuffleState = 12345;
+    for (size_t i = courseCount; i > 1; --i) {
+        shuffleState = shuffleState * 6364136223846793005ull + 1442695040888963407ull;
+        swap(order[i - 1], order[(shuffleState >> 33) % i]);
+    }
+    vector<vector<size_t>> writerLists(writerCount);
+    for (size_t i = 0; i < courseCount; ++i) {
+        size_t owner = order[i] % writerCount;
+        writerLists[owner].push_back(order[i]);
+        if (writerCount > 1) writerLists[(owner + writerCount - 1) % writerCount].push_back(order[i]);
+    }
+
+    // The index only points at courses, so they are made up front; two writers racing to insert one pass the same pointer
+    vector<Course> courses(courseCount);
+    for (size_t i = 0; i < courseCount; ++i) {
+        courses[i].courseNumber = numbers[i];
+        courses[i].courseName = expectedName(numbers[i]);
+    }
+
+    ConcurrentCourseIndex index;
+    vector<atomic<uint32_t>> wins(courseCount);
+    // progress[w] = how many of writer w's inserts have returned
+    vector<atomic<size_t>> progress(writerCount);
+    atomic<size_t> violations(0);
+    atomic<size_t> writersLeft(writerCount);
+    // Only the first few violations are printed
+    mutex reportLock;
+    auto report = [&](const string& problem) {
+        if (violations.fetch_add(1) < 5) {
+            lock_guard<mutex> guard(reportLock);
+            cout << "  FAILED: " << problem << endl;
+        }
+    };
+
+    auto started = chrono::steady_clock::now();
+    runInParallel(writerCount + readerCount, [&](size_t task) {
+        if (task < writerCount) {
+            const vector<size_t>& list = writerLists[task];
+            for (size_t k = 0; k < list.size(); ++k) {
+                if (index.insert(&courses[list[k]])) wins[list[k]].fetch_add(1);
+                progress[task].store(k + 1, memory_order_release);
+            }
+            writersLeft.fetch_sub(1);
+            return;
+        }
+
+        uint64_t state = 0x2545F4914F6CDD1Dull * (task + 1);
+        vector<size_t> seen;
+        size_t round = 0;
+        while (writersLeft.load() > 0) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            // The latest insert a writer has finished must already be visible
+            size_t writer = state % writerCount;
+            size_t done = progress[writer].load(memory_order_acquire);
+            if (done > 0) {
+                const string& number = numbers[writerLists[writer][done - 1]];
+                const Course* course = index.find(number);
+                if (!course) report("inserted course " + number + " not found by a later search");
+                else if (course != &courses[writerLists[writer][done - 1]]) report("search for " + number + " returned another course");
+            }
+
+            // A random course may or may not be there yet, but once found it must stay found
+            size_t probe = (state >> 20) % courseCount;
+            const Course* course = index.find(numbers[probe]);
+            if (course) {
+                if (course->courseNumber != numbers[probe]) report("search for " + numbers[probe] + " returned another course");
+                if (seen.size() < 4096) seen.push_back(probe);
+            }
+            if (++round % 64 == 0) {
+                for (size_t earlier : seen) {
+                    if (!index.find(numbers[earlier])) report("course " + numbers[earlier] + " disappeared");
+                }
+                seen.clear();
+            }
+        }
+    });
+    chrono::duration<double, milli> mixedTime = chrono::steady_clock::now() - started;
+
+    for (size_t i = 0; i < courseCount; ++i) {
+        uint32_t count = wins[i].load();
+        if (count != 1) report(numbers[i] + " was inserted " + to_string(count) + " times");
+        if (!index.find(numbers[i])) report(numbers[i] + " missing after the run");
+    }
+    size_t visited = 0;
+    const Course* previous = nullptr;
+    index.forEach([&](const Course& course) {
+        if (previous && !(previous->courseNumber < course.courseNumber)) {
+            report("courses out of order at " + string(course.courseNumber));
+        }
+        previous = &course;
+        ++visited;
+    });
+    if (visited != courseCount || index.size() != courseCount) {
+        report("index holds " + to_string(visited) + " courses, expected " + to_string(courseCount));
+    }
+    cout << "  Concurrent inserts and searches: " << mixedTime.count() << " ms" << endl;
+
+    // Read scaling on the finished index
+    const size_t lookupsPerThread = 1000000;
+    for (size_t threads = 1; ; threads = min(threads * 2, threadCount)) {
+        atomic<size_t> hits(0);
+        started = chrono::steady_clock::now();
+        runInParallel(threads, [&](size_t task) {
+            uint64_t state = 0x9E3779B97F4A7C15ull * (task + 1);
+            size_t found = 0;
+            for (size_t i = 0; i < lookupsPerThread; ++i) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                found += index.find(numbers[state % courseCount]) != nullptr;
+            }
+            hits.fetch_add(found);
+        });
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+        if (hits.load() != threads * lookupsPerThread) report("lookups missed during the read benchmark");
+        cout << "  Lookups on " << threads << (threads == 1 ? " thread:  " : " threads: ")
+            << threads * lookupsPerThread / elapsed.count() / 1e6 << " million/s" << endl;
+        if (threads == threadCount) break;
+    }
+
+    // Erasing: the same writers now erase the odd-numbered courses, two of them racing for each, and swap each
+    // even-numbered one for a copy with replace(), while the readers search
+    vector<Course> copies(courses);
+    vector<atomic<uint32_t>> erased(courseCount);
+    for (size_t w = 0; w < writerCount; ++w) progress[w].store(0);
+    writersLeft.store(writerCount);
+    started = chrono::steady_clock::now();
+    runInParallel(writerCount + readerCount, [&](size_t task) {
+        if (task < writerCount) {
+            const vector<size_t>& list = writerLists[task];
+            for (size_t k = 0; k < list.size(); ++k) {
+                size_t i = list[k];
+                if (i % 2 == 1) {
+                    const Course* removed = index.erase(numbers[i]);
+                    if (removed && removed != &courses[i]) report("erase of " + numbers[i] + " returned another course");
+                    if (removed) erased[i].fetch_add(1);
+                }
+                else {
+                    const Course* previous = index.replace(&copies[i]);
+                    if (previous != &courses[i] && previous != &copies[i]) report("replace of " + numbers[i] + " returned another course");
+                }
+                progress[task].store(k + 1, memory_order_release);
+            }
+            writersLeft.fetch_sub(1);
+            return;
+        }
+
+        uint64_t state = 0x2545F4914F6CDD1Dull * (task + 1);
+        while (writersLeft.load() > 0) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            // The latest erase a writer has finished must already be visible
+            size_t writer = state % writerCount;
+            size_t done = progress[writer].load(memory_order_acquire);
+            if (done > 0 && writerLists[writer][done - 1] % 2 == 1) {
+                const string& number = numbers[writerLists[writer][done - 1]];
+                if (index.find(number)) report("erased course " + number + " found by a later search");
+            }
+
+            // An even-numbered course is never missing, whether or not it has been replaced yet
+            size_t probe = ((state >> 20) % courseCount) & ~size_t(1);
+            const Course* course = index.find(numbers[probe]);
+            if (!course) report("course " + numbers[probe] + " missing while others were erased");
+            else if (course != &courses[probe] && course != &copies[probe]) report("search for " + numbers[probe] + " returned another course");
+        }
+    });
+    chrono::duration<double, milli> eraseTime = chrono::steady_clock::now() - started;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < courseCount; ++i) {
+        const Course* course = index.find(numbers[i]);
+        if (i % 2 == 1) {
+            uint32_t count = erased[i].load();
+            if (count != 1) report(numbers[i] + " was erased " + to_string(count) + " times");
+            if (course) report(numbers[i] + " still found after being erased");
+        }
+        else {
+            ++kept;
+            if (course != &copies[i]) report(numbers[i] + " does not hold its replacement after the run");
+        }
+    }
+    visited = 0;
+    previous = nullptr;
+    index.forEach([&](const Course& course) {
+        if (previous && !(previous->courseNumber < course.courseNumber)) {
+            report("courses out of order at " + string(course.courseNumber));
+        }
+        previous = &course;
+        ++visited;
+    });
+    if (visited != kept || index.size() != kept) {
+        report("index holds " + to_string(visited) + " courses after erasing, expected " + to_string(kept));
+    }
+    // No search is running any more, so the unlinked nodes can go
+    ConcurrentCourseIndex::RetiredNodes unlinked = index.takeRetired();
+    if (unlinked.size() != courseCount - kept) report(to_string(unlinked.size()) + " nodes unlinked, expected " + to_string(courseCount - kept));
+    cout << "  Concurrent erases, replacements and searches: " << eraseTime.count() << " ms" << endl;
+
+    cout << (violations.load() ? "Stress test FAILED (" + to_string(violations.load()) + " violations)" : string("Stress test passed")) << endl;
+    return violations.load() ? 1 : 0;
+}
+
+/***************************************************************
+ * KeyOrder
+ *
+ * Row order of a synthetic benchmark catalog:
+ *   - Sorted: rows already in course-number order (the shape of the real advising file); every course number fits
+ *     in its eight-byte packed key, as real ones like "CSCI300" do
+ *   - Random: the same course numbers, shuffled
+ *   - Adversarial: shuffled, and every course number shares its first eight bytes ("COMPUTERSCI..."),
+ *     so no packed key ever decides a comparison and every one falls back to comparing the strings
+ ***************************************************************/
+enum class KeyOrder {
+    Sorted,
+    Random,
+    Adversarial
+};
+
+/***************************************************************
+ * SyntheticCatalog Struct
+ *
+ * A generated catalog for the benchmarks: its CSV text plus course numbers to look up, both present and absent.
+ * Course i lists courses i / 2 and i / 3 as prerequisites (when they exist and differ from it), so popular
+ * prerequisites are shared by many courses and there are no cycles.
+ * Course i is numbered 2i (in hex, so the sorted and random orders fit eight bytes up to the benchmark's largest size)
+ * and the misses are odd numbers, so each one falls in a gap between two courses anywhere in the key range.
+ ***************************************************************/
+struct SyntheticCatalog {
+    string csv;
+    vector<string> hits;
+    vector<string> misses;
+};
+
+SyntheticCatalog makeSyntheticCatalog(size_t count, KeyOrder order, size_t lookups) {
+    // Fixed-width upper-case hex sorts like the numbers it spells
+    const char* format = order == KeyOrder::Adversarial ? "COMPUTERSCI%09zX" : "C%07zX";
+    auto formatNumber = [&](size_t number) {
+        char text[32];
+        snprintf(text, sizeof(text), format, number);
+        return string(text);
+    };
+    auto courseNumber = [&](size_t i) {
+        return formatNumber(2 * i);
+    };
+
+    vector<size_t> rows(count);
+    for (size_t i = 0; i < count; ++i) rows[i] = i;
+    uint64_t state = 0x853C49E6748FEA9Bull + count;
+    auto nextRandom = [&]() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state >> 33;
+    };
+    if (order != KeyOrder::Sorted) {
+        for (size_t i = count; i > 1; --i) swap(rows[i - 1], rows[nextRandom() % i]);
+    }
+
+    SyntheticCatalog catalog;
+    catalog.csv.reserve(count * 64);
+    for (size_t i : rows) {
+        catalog.csv += courseNumber(i);
+        catalog.csv += ",Synthetic Course ";
+        catalog.csv += to_string(i);
+        if (i / 2 != i) {
+            catalog.csv += ',';
+            catalog.csv += courseNumber(i / 2);
+        }
+        if (i / 3 != i / 2) {
+            catalog.csv += ',';
+            catalog.csv += courseNumber(i / 3);
+        }
+        catalog.csv += '\n';
+    }
+
+    // Lookups in random order; a miss sits just after a random course, so an ordered search goes all the way down
+    for (size_t k = 0; k < lookups; ++k) {
+        catalog.hits.push_back(courseNumber(nextRandom() % count));
+        catalog.misses.push_back(formatNumber(2 * (nextRandom() % count) + 1));
+    }
+    return catalog;
+}
+
+/***************************************************************
+ * NullStreamBuf Class
+ *
+ * A streambuf that discards everything, so printAll's formatting can be timed without a terminal in the way.
+ ***************************************************************/
+class NullStreamBuf : public streambuf {
+protected:
+    streamsize xsputn(const char*, streamsize count) override {
+        return count;
+    }
+
+    int_type overflow(int_type c) override {
+        return traits_type::not_eof(c);
+    }
+};
+
+/***************************************************************
+ * runBenchmarks
+ *
+ * What --bench runs: for catalogs of 1,000 courses and every tenfold size up to maxCourses, in each KeyOrder,
+ * times the main operations and prints one row per measurement (nanoseconds per course or per lookup):
+ *   - load:     loadCourses on the catalog written to a temporary CSV (parse, sort, bulk build, resolve)
+ *   - insert:   CourseBST::insert of every course, one at a time, into an empty tree
+ *   - hit/miss (tree): CourseBST::searchTree, a descent of the tree itself, for course numbers that are / aren't
+ *     in the catalog (CourseBST::search asks its hash index, which the "hash" backend rows below time)
+ *   - printAll: printing the sorted list into a null sink
+ *   - resolve:  CourseBST::resolvePrerequisites on the loaded tree
+ * Then, for every CourseIndex backend (or just the named one), times building it from the sorted courses, inserting
+ * the courses one at a time in file order, and lookup hits and misses, so the alternatives the Project One analysis
+ * compared can be measured on the same catalogs, and the same for a FrozenCatalog (build, hits, misses and printAll).
+ * Each measurement is the best of three runs. Input copies and the teardown of the previous run's structure happen
+ * before the clock starts, as in compareLoadModes, so only the operation itself is timed.
+ * Returns the process exit code.
+ ***************************************************************/
+int runBenchmarks(size_t maxCourses, const string& backend) {
+    const size_t lookups = 200000;
+    const int runs = 3;
+    string csvPath = (filesystem::temp_directory_path() / ("abcu_bench_" + to_string(hash<thread::id>{}(this_thread::get_id())) + ".csv")).string();
+
+    // Best-of-runs time of work, in nanoseconds per item. prepare runs before the clock starts on every run,
+    // so copying the input and tearing down the previous run's structure are never timed.
+    auto bestPreparedNanos = [&](size_t items, auto prepare, auto work) {
+        double best = numeric_limits<double>::max();
+        for (int run = 0; run < runs; ++run) {
+            prepare();
+            auto start = chrono::steady_clock::now();
+            work();
+            chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+            best = min(best, elapsed.count() / max<size_t>(1, items));
+        }
+        return best;
+    };
+    auto bestNanos = [&](size_t items, auto work) {
+        return bestPreparedNanos(items, [] {}, work);
+    };
+
+    NullStreamBuf nullBuffer;
+    streambuf* savedOutput = cout.rdbuf();
+    auto report = [&](const char* order, size_t courses, const char* operation, double nanos) {
+        char line[128];
+        snprintf(line, sizeof(line), "%-12s %9zu  %-18s %10.1f\n", order, courses, operation, nanos);
+        cout.rdbuf(savedOutput);
+        cout << line << flush;
+        cout.rdbuf(&nullBuffer);
+    };
+
+    cout << "order          courses  operation          ns per item" << endl;
+    // The loaders' own messages would swamp the table
+    cout.rdbuf(&nullBuffer);
+    // A volatile sink keeps the lookup loops from being optimized away
+    volatile size_t found = 0;
+
+    const pair<KeyOrder, const char*> orders[] = {
+        { KeyOrder::Sorted, "sorted" }, { KeyOrder::Random, "random" }, { KeyOrder::Adversarial, "adversarial" }
+    };
+    for (size_t courses = 1000; courses <= maxCourses; courses *= 10) {
+        for (const auto& [order, orderName] : orders) {
+            SyntheticCatalog catalog = makeSyntheticCatalog(courses, order, lookups);
+            {
+                ofstream out(csvPath, ios::binary);
+                out.write(catalog.csv.data(), static_cast<streamsize>(catalog.csv.size()));
+            }
+
+            CourseBST bst;
+            report(orderName, courses, "load", bestPreparedNanos(courses, [&] {
+                bst.clear();
+            }, [&] {
+                loadCourses(csvPath, bst);
+            }));
+
+            vector<Course> parsed;
+            parseCourseFile(csvPath, parsed, 1, false);
+            unique_ptr<CourseBST> inserted;
+            vector<Course> input;
+            report(orderName, courses, "insert", bestPreparedNanos(courses, [&] {
+                inserted = make_unique<CourseBST>();
+                input = parsed;
+            }, [&] {
+                for (auto& course : input) inserted->insert(move(course));
+            }));
+            inserted.reset();
+            input = vector<Course>();
+
+            report(orderName, courses, "hit (tree)", bestNanos(lookups, [&] {
+                size_t count = 0;
+                for (const string& key : catalog.hits) count += bst.searchTree(key) != nullptr;
+                found += count;
+            }));
+            report(orderName, courses, "miss (tree)", bestNanos(lookups, [&] {
+                size_t count = 0;
+                for (const string& key : catalog.misses) count += bst.searchTree(key) != nullptr;
+                found += count;
+            }));
+
+            // bufferedOut writes to cout, which points at the null sink here
+            report(orderName, courses, "printAll", bestNanos(courses, [&] {
+                bst.printAll();
+                bufferedOut.flush();
+            }));
+
+            report(orderName, courses, "resolve", bestNanos(courses, [&] {
+                bst.resolvePrerequisites();
+            }));
+
+            // The same catalog through each backend: bulk build, one-at-a-time inserts in file order, and lookups
+            vector<const Course*> sortedCourses;
+            for (const Course& course : bst) sortedCourses.push_back(&course);
+            vector<const Course*> fileOrder;
+            for (const Course& course : parsed) fileOrder.push_back(bst.search(course.courseNumber));
+            for (const char* backendName : courseIndexNames) {
+                if (!backend.empty() && backend != backendName) continue;
+                unique_ptr<CourseIndex> index;
+                string label = string(" (") + backendName + ")";
+
+                report(orderName, courses, ("build" + label).c_str(), bestPreparedNanos(courses, [&] {
+                    index = makeCourseIndex(backendName);
+                }, [&] {
+                    index->build(sortedCourses);
+                }));
+                // Inserting into a sorted vector is quadratic; past 100,000 courses it would take minutes
+                if (string_view(backendName) != "sorted" || courses <= 100000) {
+                    unique_ptr<CourseIndex> insertedIndex;
+                    report(orderName, courses, ("insert" + label).c_str(), bestPreparedNanos(courses, [&] {
+                        insertedIndex = makeCourseIndex(backendName);
+                    }, [&] {
+                        for (const Course* course : fileOrder) insertedIndex->insert(course);
+                    }));
+                }
+                report(orderName, courses, ("hit" + label).c_str(), bestNanos(lookups, [&] {
+                    size_t count = 0;
+                    for (const string& key : catalog.hits) count += index->find(key) != nullptr;
+                    found += count;
+                }));
+                report(orderName, courses, ("miss" + label).c_str(), bestNanos(lookups, [&] {
+                    size_t count = 0;
+                    for (const string& key : catalog.misses) count += index->find(key) != nullptr;
+                    found += count;
+                }));
+            }
+
+            // The frozen copy, against the tree's own rows above
+            if (backend.empty() || backend == frozenBackendName) {
+                unique_ptr<FrozenCatalog> frozenCopy;
+                report(orderName, courses, "build (frozen)", bestPreparedNanos(courses, [&] {
+                    frozenCopy = make_unique<FrozenCatalog>();
+                }, [&] {
+                    frozenCopy->freeze(bst);
+                }));
+                const FrozenCatalog& frozen = *frozenCopy;
+                report(orderName, courses, "hit (frozen)", bestNanos(lookups, [&] {
+                    size_t count = 0;
+                    for (const string& key : catalog.hits) count += frozen.find(key) != FrozenCatalog::noTarget;
+                    found += count;
+                }));
+                report(orderName, courses, "miss (frozen)", bestNanos(lookups, [&] {
+                    size_t count = 0;
+                    for (const string& key : catalog.misses) count += frozen.find(key) != FrozenCatalog::noTarget;
+                    found += count;
+                }));
+                report(orderName, courses, "printAll (frozen)", bestNanos(courses, [&] {
+                    frozen.printAll();
+                    bufferedOut.flush();
+                }));
+            }
+        }
+    }
+
+    cout.rdbuf(savedOutput);
+    error_code ignored;
+    filesystem::remove(csvPath, ignored);
+    return 0;
+}
+
+/***************************************************************
+ * printUsage
+ *
+ * Describes the command-line flags.
+ ***************************************************************/
+void printUsage(ostream& out, const char* program) {
+    out << "Usage: " << program << " [--csv FILE] [--batch FILE|- | --serve PORT | --stress N | --bench N] [--threads N] [--cache N] [--backend B] [--validate V] [--format tsv|jsonl]" << endl;
+    out << "  With no flags, runs the interactive menu." << endl;
+    out << "  --batch FILE  answer one course number per line of FILE (- for stdin) without prompts" << endl;
+    out << "  --serve PORT  answer course numbers sent over TCP, one per line, until stopped (!reload or SIGHUP reloads)" << endl;
+    out << "  --stress N    check the skiplist backend with N courses inserted, erased and searched from many threads" << endl;
+    out << "  --bench N     time loading, inserts, lookups, printing, prerequisite resolution and every backend on synthetic catalogs" << endl;
+    out << "                of 1,000 up to N courses (at most 10,000,000) in sorted, random and adversarial order" << endl;
+    out << "  --threads N   threads for --serve and --stress (default: one per hardware thread)" << endl;
+    out << "  --backend B   lookup structure for batch, server and bench mode: sorted, hash, avl, btree, skiplist or frozen" << endl;
+    out << "                (default: the tree's own hash index, or the snapshot's; --bench then runs all six)" << endl;
+    out << "  --validate V  check the catalog batch and server mode load for skipped rows, self-referencing and dangling" << endl;
+    out << "                prerequisites and cycles: report prints what was found, strict also rejects a catalog with problems" << endl;
+    out << "                (batch mode exits, a server keeps its current version)" << endl;
+    out << "  --cache N     responses cached per menu session or server thread (default 256, 0 turns caching off)" << endl;
+    out << "  --csv FILE    course file for batch and server mode (default \"CS 300 ABCU_Advising_Program_Input.csv\")" << endl;
+    out << "  --format F    batch and server output: tsv (default) or jsonl" << endl;
+}
+
+/***************************************************************
+ * main
+ *
+ * Main entry point. Presents a menu-driven UI that allows users to:
+ *   - Load courses from a file (Option 1)
+ *   - Print all courses in sorted order (Option 2)
+ *   - Search for a single course (Option 3)
+ *   - Compare insert-based and bulk loading (Option 4)
+ *   - Print a course's full (transitive) prerequisite chain (Option 5)
+ *   - Plan semesters for a set of target courses (Option 6)
+ *   - List the courses with a given prefix, such as a department (Option 7)
+ *   - List the courses between two course numbers (Option 8)
+ *   - Search course numbers and titles, tolerating typos (Option 10)
+ *   - Show statistics (Option 11)
+ *   - Check the loaded file for invalid rows, duplicates, dangling prerequisites and cycles (Option 12)
+ *   - Exit (Option 9)
+ *
+ * If the user attempts to print or search before loading, they are prompted to load data first.
+ * Given --batch, it instead answers course lookups from a file or stdin without the menu (see runBatch and printUsage),
+ * given --serve it answers them over TCP (see runServer), given --stress it checks the concurrent index (see runStressTest),
+ * and given --bench it times the data structures on synthetic catalogs (see runBenchmarks).
+ ***************************************************************/
+int main(int argc, char* argv[]) {
+    // Command-line flags select batch or server mode; without them the menu runs as before
+    string csvFile = "CS 300 ABCU_Advising_Program_Input.csv";
+    string batchFile;
+    BatchFormat batchFormat = BatchFormat::Tsv;
+    size_t servePort = 0;
+    size_t stressCourses = 0;
+    size_t cacheEntries = 256;
+    size_t benchCourses = 0;
+    // Empty means the default lookups (and every backend for --bench)
+    string backend;
+    ValidationMode validation = ValidationMode::Off;
+    size_t serveThreads = max(1u, thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        string flag = argv[i];
+        if (flag == "--help" || flag == "-h") {
+            printUsage(cout, argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc || (flag != "--csv" && flag != "--batch" && flag != "--format"
+            && flag != "--serve" && flag != "--threads" && flag != "--stress" && flag != "--cache" && flag != "--bench" && flag != "--backend"
+            && flag != "--validate")) {
+            printUsage(cerr, argv[0]);
+            return 2;
+        }
+        string value = argv[++i];
+        if (flag == "--csv") {
+            csvFile = value;
+        }
+        else if (flag == "--batch") {
+            batchFile = value;
+        }
+        else if (flag == "--backend") {
+            if (value != frozenBackendName && !makeCourseIndex(value)) {
+                printUsage(cerr, argv[0]);
+                return 2;
+            }
+            backend = value;
+        }
+        else if (flag == "--serve" || flag == "--threads" || flag == "--stress" || flag == "--cache" || flag == "--bench") {
+            bool valid = flag == "--serve" ? parseWholeNumber(value, 1, 65535, servePort)
+                : flag == "--threads" ? parseWholeNumber(value, 1, 1024, serveThreads)
+                : flag == "--stress" ? parseWholeNumber(value, 1, 100000000, stressCourses)
+                : flag == "--bench" ? parseWholeNumber(value, 1000, 10000000, benchCourses)
+                : parseWholeNumber(value, 0, 1000000, cacheEntries);
+            if (!valid) {
+                printUsage(cerr, argv[0]);
+                return 2;
+            }
+        }
+        else if (flag == "--format" && (value == "tsv" || value == "jsonl")) {
+            batchFormat = value == "tsv" ? BatchFormat::Tsv : BatchFormat::Jsonl;
+        }
+        else if (flag == "--validate" && (value == "report" || value == "strict")) {
+            validation = value == "report" ? ValidationMode::Report : ValidationMode::Strict;
+        }
+        else {
+            printUsage(cerr, argv[0]);
+            return 2;
+        }
+    }
+    if (!batchFile.empty()) {
+        // Nothing in batch mode reads stdio through C, so the streams don't need to stay in sync with it
+        ios::sync_with_stdio(false);
+        if (batchFile == "-") return runBatch(csvFile, cin, batchFormat, backend, validation);
+
+        ifstream queries(batchFile);
+        if (!queries) {
+            cerr << "ERROR: Could not open file: " << batchFile << endl;
+            return 1;
+        }
+        return runBatch(csvFile, queries, batchFormat, backend, validation);
+    }
+    // The menu and the stress test always use their own structures, so a backend there would silently do nothing
+    if (!backend.empty() && (stressCourses || (!benchCourses && !servePort))) {
+        cerr << "ERROR: --backend only applies to --batch, --serve and --bench" << endl;
+        return 2;
+    }
+    if (stressCourses) {
+        return runStressTest(stressCourses, serveThreads);
+    }
+    if (benchCourses) {
+        return runBenchmarks(benchCourses, backend);
+    }
+    if (servePort) {
+        return runServer(csvFile, static_cast<uint16_t>(servePort), serveThreads, batchFormat, cacheEntries, backend, validation);
+    }
+
+    // Chosen data structure (BST)
+    CourseBST bst;
+    // Flat copy of the prerequisite links, rebuilt after every load
+    PrerequisiteGraph graph;
+    // Trigram index over course numbers and titles, rebuilt after a load when a search first needs it
+    TitleIndex titles;
+    // Tracks whether data has been loaded
+    bool loaded = false; 
+    // The file the data was loaded from (used by the load mode comparison)
+    string loadedFilename;
+    // Mapped snapshot of the loaded file, when one was valid at load time
+    unique_ptr<CourseSnapshot> snapshot = make_unique<CourseSnapshot>();
+    // Formatted "Print Course" responses, dropped whenever a load changes the catalog
+    ResponseCache responses(cacheEntries);
+    // True while bst and graph hold the loaded catalog (a snapshot load fills them only when a menu option needs them)
+    bool treeReady = false;
+    // A course's number and title by id, from the tree when it is built and from the snapshot otherwise
+    // (both number courses in sorted order, so the ids agree)
+    auto courseText = [&](size_t id) {
+        if (treeReady) {
+            const Course& course = bst.courseAt(id);
+            return make_pair(string_view(course.courseNumber), string_view(course.courseName));
+        }
+        return make_pair(snapshot->courseNumber(id), snapshot->courseName(id));
+    };
+    // Builds bst and graph from the snapshot the first time an option needs the full tree
+    auto ensureTree = [&]() {
+        if (treeReady) return;
+        bst.clear();
+        bst.bulkLoad(snapshot->toCourses());
+        bst.resolvePrerequisites();
+        graph.build(bst);
+        treeReady = true;
+    };
+
+    cout << "Welcome to the course planner." << endl << endl;
+
+    int choice = 0;
+    while (choice != 9) {
+        // Display menu options
+        bufferedOut << "  1. Load Data Structure.\n";
+        bufferedOut << "  2. Print Course List.\n";
+        bufferedOut << "  3. Print Course.\n";
+        bufferedOut << "  4. Compare Load Modes.\n";
+        bufferedOut << "  5. Print Full Prerequisite Chain.\n";
+        bufferedOut << "  6. Plan Semesters.\n";
+        bufferedOut << "  7. List Courses by Prefix.\n";
+        bufferedOut << "  8. List Courses in Range.\n";
+        bufferedOut << "  10. Search Course Titles.\n";
+        bufferedOut << "  11. Show Statistics.\n";
+        bufferedOut << "  12. Validate Catalog.\n";
+        bufferedOut << "  9. Exit\n";
+        bufferedOut << "\nWhat would you like to do? ";
+        bufferedOut.flush();
+
+        cin >> choice;
+
+        // Check if cin failed to parse an integer
+        if (!cin) {
+            // Clear error flags
+            cin.clear();
+            // Discard any leftover input up to a newline (prevents infinite loop)
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+            // Show a single error message
+            cout << "Input is not a valid option." << endl << endl;
+
+            // Go back to top of the while loop (re-display the menu)
+            continue;
+        }
+
+        // Clear leftover newline from input buffer
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        // The command's own time is what's left after the time spent in readUserLine
+        ABCU_METRIC(uint64_t commandStart = metricsClock(); uint64_t waitedBefore = metrics.inputWaitNanos.load(memory_order_relaxed));
+
+        // Respond to user's choice
+        switch (choice) {
+        // Added tools to improve user experience
+        case 1: {
+            cout << "Enter the file name to load (case-insensitive, with or without .csv): ";
+            string inputName;
+            readUserLine(inputName);
+
+            // The *correct base name* in exact case
+            const string correctBase = "CS 300 ABCU_Advising_Program_Input";
+            // Use all-caps of the base for easy ignoring-case checks
+            const string correctBaseCaps = "CS 300 ABCU_ADVISING_PROGRAM_INPUT";
+
+            // Convert user input to uppercase for comparison
+            string inputCaps = inputName;
+            for (auto& c : inputCaps) {
+                c = toupper(static_cast<unsigned char>(c));
+            }
+
+            // STEP 1: Check if the user typed .csv at the end (in any case).
+            //         If yes, remove it before comparing to the correct base.
+            bool hasCsvExtension = false;
+            if (inputCaps.size() >= 4 &&
+                inputCaps.substr(inputCaps.size() - 4) == ".CSV")
+            {
+                hasCsvExtension = true;
+                // Remove the last 4 characters (".csv") so the base is left
+                inputCaps = inputCaps.substr(0, inputCaps.size() - 4);
+            }
+
+            // STEP 2: Compare what's left to the expected base name, ignoring case
+            if (inputCaps == correctBaseCaps) {
+                // If it matches ignoring case, accept it.
+                // Build the final filename in the exact case desired:
+                string finalFilename = correctBase + ".csv";
+
+                // Inform the user to how their input is being resolved
+                cout << "Using file: " << finalFilename << endl;
+
+                // Loading the same file again only has to apply what changed since the last load
+                bool reload = loaded && loadedFilename == finalFilename;
+
+                // Use the snapshot from an earlier load if it still matches the file; otherwise parse the CSV
+                string snapshotProblem;
+                unique_ptr<CourseSnapshot> candidate = make_unique<CourseSnapshot>();
+                if (candidate->open(finalFilename, snapshotProblem)) {
+                    if (reload && treeReady) {
+                        // The snapshot matches the file, so the tree built from it is still current
+                        cout << "Courses unchanged since the last load." << endl;
+                    }
+                    else {
+                        snapshot = move(candidate);
+                        responses.clear();
+                        cout << "Loaded " << snapshot->size() << " courses from snapshot "
+                            << CourseSnapshot::pathFor(finalFilename) << "." << endl;
+                        treeReady = false;
+                        titles.buildLater(snapshot->size(), courseText);
+                    }
+                }
+                else {
+                    if (snapshotProblem != "no snapshot") {
+                        cout << "Rebuilding snapshot (" << snapshotProblem << ")." << endl;
+                    }
+                    bool ok;
+                    if (reload) {
+                        // Patch the loaded tree with the rows that changed
+                        ensureTree();
+                        ok = reloadCourses(finalFilename, bst);
+                    }
+                    else {
+                        // Now actually load courses from that file
+                        bst.clear();
+                        ok = loadCourses(finalFilename, bst);
+                    }
+                    // A failed reload keeps the old tree; a failed fresh load leaves an empty one
+                    if (ok || !reload) {
+                        responses.clear();
+                        graph.build(bst);
+                        treeReady = true;
+                        titles.buildLater(bst.size(), courseText);
+                        // The tree is the catalog now; release the old mapping
+                        snapshot = make_unique<CourseSnapshot>();
+                    }
+                    if (ok && !CourseSnapshot::write(bst, finalFilename)) {
+                        cout << "WARNING: Could not write snapshot " << CourseSnapshot::pathFor(finalFilename) << endl;
+                    }
+                }
+                loaded = true;
+                loadedFilename = finalFilename;
+            }
+            else {
+                // The input didn't match "CS 300 ABCU_Advising_Program_Input" ignoring case
+                cout << "ERROR: The file name does not match \""
+                    << correctBase << "\" (ignoring case)." << endl;
+                cout << "Please re-check your spelling and try again." << endl;
+            }
+
+            break;
+        }
+        case 2:
+            if (!loaded) {
+                // If no data loaded yet, ask user to load first
+                bufferedOut << "Please load courses before printing the list.\n";
+            }
+            else {
+                // Print all courses in sorted (in-order) order
+                bufferedOut << "Here is the course schedule:\n\n";
+                if (treeReady) {
+                    bst.printAll();
+                }
+                else {
+                    // The snapshot's records are already in sorted order
+                    for (size_t i = 0; i < snapshot->size(); ++i) {
+                        bufferedOut << snapshot->courseNumber(i) << ", " << snapshot->courseName(i) << '\n';
+                    }
+                }
+                bufferedOut << '\n';
+            }
+            break;
+        case 3:
+            if (!loaded) {
+                // If no is data loaded, it is impossible to search
+                bufferedOut << "Please load courses before searching for a course.\n";
+            }
+            else if (treeReady) {
+                printCourseInfo(bst, titles, responses);
+                bufferedOut << '\n';
+            }
+            else {
+                printCourseInfo(*snapshot, titles, responses);
+                bufferedOut << '\n';
+            }
+            break;
+        case 4:
+            if (!loaded) {
+                // The comparison reuses the file that was loaded
+                cout << "Please load courses before comparing load modes." << endl;
+            }
+            else {
+                compareLoadModes(loadedFilename);
+                cout << endl;
+            }
+            break;
+        case 5:
+            if (!loaded) {
+                bufferedOut << "Please load courses before asking for a prerequisite chain.\n";
+            }
+            else {
+                ensureTree();
+                printPrerequisiteChain(bst, graph);
+                bufferedOut << '\n';
+            }
+            break;
+        case 6:
+            if (!loaded) {
+                bufferedOut << "Please load courses before planning semesters.\n";
+            }
+            else {
+                ensureTree();
+                SemesterPlanner planner(graph);
+                printSemesterPlan(bst, planner);
+                bufferedOut << '\n';
+            }
+            break;
+        case 7:
+        case 8:
+            if (!loaded) {
+                bufferedOut << "Please load courses before listing courses.\n";
+            }
+            else {
+                CourseKeyRange range = choice == 7 ? readPrefixQuery() : readRangeQuery();
+                if (treeReady) {
+                    printCourseRange(bst, range);
+                }
+                else {
+                    printCourseRange(*snapshot, range);
+                }
+                bufferedOut << '\n';
+            }
+            break;
+        case 10:
+            if (!loaded) {
+                bufferedOut << "Please load courses before searching titles.\n";
+            }
+            else {
+                printTitleSearch(titles, courseText);
+                bufferedOut << '\n';
+            }
+            break;
+        case 11:
+            printMetrics(bst, treeReady || !loaded, responses);
+            bufferedOut << '\n';
+            break;
+        case 12:
+            if (!loaded) {
+                cout << "Please load courses before validating the catalog." << endl;
+            }
+            else {
+                // Checks the file that was loaded, like the load mode comparison
+                validateCatalogFile(loadedFilename);
+                cout << endl;
+            }
+            break;
+        case 9:
+            // Exit the loop => end program
+            if (loaded) {
+                printCacheStats(responses);
+                bufferedOut.flush();
+            }
+            cout << "Thank you for using the course planner!" << endl;
+            cout << "Press ENTER to close the program..." << endl;
+
+            // Clear any leftover characters from the buffer
+            cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            // Wait for the user to press ENTER
+            cin.get();
+
+            // After the user presses ENTER the program ends.
+            break;
+        default:
+            // Invalid menu option
+            cout << choice << " is not a valid option." << endl << endl;
+            break;
+        }
+        // Write out everything the command printed in one go
+        bufferedOut.flush();
+        // Exit's time is mostly the wait for ENTER
+        ABCU_METRIC(if (choice != 9) {
+            uint64_t waited = metrics.inputWaitNanos.load(memory_order_relaxed) - waitedBefore;
+            metrics.commands[choice > 0 && size_t(choice) < Metrics::commandCount ? choice : 0].record(metricsClock() - commandStart - waited);
+        });
+    }
+
+    // End of program
+    return 0;  
+}